@@ -15,25 +15,147 @@
     BigInt
     ===========================================================================
     Definition for the BigInt class.
+    The magnitude is stored as little-endian 64-bit limbs with no leading zero
+    limbs (zero has no limbs at all); decimal text is only produced on output.
+    Magnitudes of up to 128 bits are kept inline in the object and only larger
+    ones are moved to the heap.
 */
 
 #pragma once
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
 #include <iostream>
+#include <random>
 #include <string>
+#include <tuple>
+#include <utility>
 
 class BigInt {
-    std::string value;
+public:
+    /*
+        Limbs
+        -----
+        A vector of 64-bit limbs with room for two limbs inside the object,
+        so that small values never touch the heap.
+    */
+    class Limbs {
+    public:
+        static constexpr size_t inline_capacity = 2;
+
+        Limbs() : data_(inline_), size_(0), capacity_(inline_capacity) {}
+        explicit Limbs(size_t size) : Limbs() { resize(size); }
+        Limbs(const Limbs& other) : Limbs() { *this = other; }
+        Limbs(Limbs&& other) noexcept : Limbs() { *this = std::move(other); }
+        ~Limbs()
+        {
+            if (data_ != inline_)
+                delete[] data_;
+        }
+
+        Limbs& operator=(const Limbs& other)
+        {
+            if (this != &other)
+                assign(other.begin(), other.end());
+            return *this;
+        }
+        // steals a heap buffer, inline limbs are copied
+        Limbs& operator=(Limbs&& other) noexcept
+        {
+            if (this == &other)
+                return *this;
+            if (other.data_ == other.inline_) {
+                std::copy(other.begin(), other.end(), data_);
+            } else {
+                if (data_ != inline_)
+                    delete[] data_;
+                data_ = other.data_;
+                capacity_ = other.capacity_;
+                other.data_ = other.inline_;
+                other.capacity_ = inline_capacity;
+            }
+            size_ = other.size_;
+            other.size_ = 0;
+            return *this;
+        }
+
+        size_t size() const { return size_; }
+        bool empty() const { return size_ == 0; }
+        uint64_t* data() { return data_; }
+        const uint64_t* data() const { return data_; }
+        uint64_t* begin() { return data_; }
+        const uint64_t* begin() const { return data_; }
+        uint64_t* end() { return data_ + size_; }
+        const uint64_t* end() const { return data_ + size_; }
+        uint64_t& operator[](size_t i) { return data_[i]; }
+        const uint64_t& operator[](size_t i) const { return data_[i]; }
+        uint64_t& back() { return data_[size_ - 1]; }
+        const uint64_t& back() const { return data_[size_ - 1]; }
+
+        void clear() { size_ = 0; }
+        void pop_back() { size_--; }
+        void push_back(uint64_t limb)
+        {
+            if (size_ == capacity_)
+                reserve(2 * capacity_);
+            data_[size_++] = limb;
+        }
+        // new limbs are zeroed
+        void resize(size_t size)
+        {
+            reserve(size);
+            if (size > size_)
+                std::fill(data_ + size_, data_ + size, 0);
+            size_ = size;
+        }
+        void assign(size_t size, uint64_t limb)
+        {
+            reserve(size);
+            std::fill(data_, data_ + size, limb);
+            size_ = size;
+        }
+        void assign(const uint64_t* first, const uint64_t* last)
+        {
+            reserve(last - first);
+            std::copy(first, last, data_);
+            size_ = last - first;
+        }
+        void reserve(size_t capacity)
+        {
+            if (capacity <= capacity_)
+                return;
+            uint64_t* data = new uint64_t[capacity];
+            std::copy(data_, data_ + size_, data);
+            if (data_ != inline_)
+                delete[] data_;
+            data_ = data;
+            capacity_ = capacity;
+        }
+
+    private:
+        uint64_t* data_;
+        size_t size_;
+        size_t capacity_;
+        uint64_t inline_[inline_capacity];
+    };
+
+private:
+    Limbs value;
     char sign;
 
+    void add_in_place(const Limbs&, char);
+
 public:
     // Constructors:
     BigInt();
     BigInt(const BigInt&);
+    BigInt(BigInt&&) noexcept;
     BigInt(const long long&);
     BigInt(const std::string&);
 
     // Assignment operators:
     BigInt& operator=(const BigInt&);
+    BigInt& operator=(BigInt&&) noexcept;
     BigInt& operator=(const long long&);
     BigInt& operator=(const std::string&);
 
@@ -81,6 +203,18 @@ public:
     BigInt operator++(int);  // post-increment
     BigInt operator--(int);  // post-decrement
 
+    // Bitwise operators (negative numbers act as infinite two's complement):
+    BigInt operator<<(size_t) const;
+    BigInt operator>>(size_t) const;
+    BigInt operator&(const BigInt&) const;
+    BigInt operator|(const BigInt&) const;
+    BigInt operator^(const BigInt&) const;
+    BigInt& operator<<=(size_t);
+    BigInt& operator>>=(size_t);
+    BigInt& operator&=(const BigInt&);
+    BigInt& operator|=(const BigInt&);
+    BigInt& operator^=(const BigInt&);
+
     // Relational operators:
     bool operator<(const BigInt&) const;
     bool operator>(const BigInt&) const;
@@ -111,16 +245,34 @@ public:
     long to_long() const;
     long long to_long_long() const;
 
+    // Bit functions:
+    size_t bit_length() const;
+    bool test_bit(size_t) const;
+    size_t popcount() const;
+
+    // Limb access functions:
+    size_t limb_count() const;
+    uint64_t limb(size_t) const;
+    const uint64_t* limb_data() const;
+    static BigInt from_limbs(const uint64_t*, size_t);
+
+    // Division with remainder:
+    friend std::tuple<BigInt, BigInt> divmod(const BigInt&, const BigInt&);
+
     // Random number generating functions:
     friend BigInt big_random(size_t);
 };
 
+std::tuple<BigInt, BigInt> divmod(const BigInt& dividend, const BigInt& divisor);
+std::from_chars_result from_chars(
+        const char* first, const char* last, BigInt& value);
 BigInt abs(const BigInt& num);
 BigInt big_pow10(size_t exp);
 BigInt pow(const BigInt& base, int exp);
 BigInt pow(const long long& base, int exp);
 BigInt pow(const std::string& base, int exp);
 BigInt sqrt(const BigInt& num);
+BigInt isqrt(const BigInt& num);
 BigInt gcd(const BigInt& num1, const BigInt& num2);
 BigInt gcd(const BigInt& num1, const long long& num2);
 BigInt gcd(const BigInt& num1, const std::string& num2);
@@ -134,3 +286,4 @@ BigInt lcm(const std::string& num1, const BigInt& num2);
 std::istream& operator>>(std::istream&, BigInt&);
 std::ostream& operator<<(std::ostream&, const BigInt&);
 BigInt big_random(size_t);
+BigInt big_random(size_t num_digits, std::mt19937_64& generator);
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <array>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace petliukh::cryptography {
+
+// Codebook of a cipher that maps every UTF-16 code unit to the same
+// ciphertext token under one key. Tokens produced by encryption are found by
+// code unit in a table of 256-entry pages that are allocated on first use,
+// and characters are found by token in a hash map, so repeated symbols skip
+// the BigInt arithmetic in both directions. At most `capacity` tokens are
+// kept; later ones are simply not cached. The owner clears it on key change.
+// Copies keep the capacity but start empty.
+class Codebook_cache {
+public:
+    explicit Codebook_cache(size_t capacity);
+    Codebook_cache(const Codebook_cache& other);
+    Codebook_cache& operator=(const Codebook_cache& other);
+
+    // an empty view when the code unit is not cached
+    std::string_view find_token(char16_t chr) const;
+    std::optional<char16_t> find_char(std::string_view token) const;
+    // a token produced by encrypting chr, cached for both directions
+    void insert_encrypted(char16_t chr, std::string token);
+    // a token that decrypted to chr, which need not be the one encryption
+    // would produce, so it is cached for decryption only
+    void insert_decrypted(std::string token, char16_t chr);
+    void clear();
+
+private:
+    using Page = std::array<std::string_view, 256>;
+
+    std::string_view store_(std::string token, char16_t chr);
+
+    size_t m_capacity;
+    std::deque<std::string> m_tokens;
+    std::array<std::unique_ptr<Page>, 256> m_pages;
+    std::unordered_map<std::string_view, char16_t> m_chars;
+};
+
+}  // namespace petliukh::cryptography
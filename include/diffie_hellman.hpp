@@ -1,15 +1,31 @@
 #include "BigInt.hpp"
+#include "numeric_utils.hpp"
 
 namespace petliukh::cryptography {
 
+// Public parameters: a safe prime p = 2q + 1 and a generator g of the
+// subgroup of prime order q. A pair built from g and p alone leaves q at 0,
+// which stands for (p - 1) / 2.
 struct Diffie_hellman_public_pair {
     BigInt g;
     BigInt p;
+    BigInt q = 0;
 };
 
-Diffie_hellman_public_pair diffie_hellman_generate_public_pair();
+// Generates a safe prime of about `digits` digits, with g = 4. Every square
+// other than 1 modulo a safe prime generates the subgroup of order q, which
+// keeps shared values from leaking the secret's parity the way a generator of
+// the whole group would.
+Diffie_hellman_public_pair diffie_hellman_generate_public_pair(
+        size_t digits = 30);
 BigInt diffie_hellman_share(
         const Diffie_hellman_public_pair& dh_pair, const BigInt& secret);
+// The same with a comb table for g modulo p, which pays off when many shares
+// are computed in one group.
+Fixed_base_exp diffie_hellman_generator_table(
+        const Diffie_hellman_public_pair& dh_pair);
+BigInt diffie_hellman_share(
+        const Fixed_base_exp& generator, const BigInt& secret);
 BigInt diffie_hellman_get_common_key(
         const BigInt& shared, const BigInt& secret, const BigInt& modulus);
 
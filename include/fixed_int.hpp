@@ -0,0 +1,478 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <tuple>
+#include "BigInt.hpp"
+
+namespace petliukh::cryptography {
+
+// Signed integer of a compile-time number of bits (a multiple of 64), kept as
+// two's complement limbs on the stack, least significant first. Like the
+// built-in integers, +, - and * wrap modulo 2^Bits, and / and % truncate
+// towards zero. Every kernel loops over a constant number of limbs, so the
+// compiler can unroll it, and nothing allocates. The interface is the subset
+// of BigInt used by the numeric_utils templates, so Fixed_int can stand in
+// for BigInt in gcd_extended, mod_inverse and mod_exp.
+template<size_t Bits>
+class Fixed_int {
+    static_assert(Bits > 0 && Bits % 64 == 0,
+                  "Fixed_int width must be a positive multiple of 64 bits");
+
+public:
+    static constexpr size_t limb_count = Bits / 64;
+    using Limbs = std::array<uint64_t, limb_count>;
+
+    constexpr Fixed_int() : m_limbs{} {}
+    constexpr Fixed_int(long long num) : m_limbs{}
+    {
+        m_limbs[0] = num;
+        for (size_t i = 1; i < limb_count; i++)
+            m_limbs[i] = num < 0 ? ~uint64_t(0) : 0;
+    }
+    explicit Fixed_int(const BigInt& num) : m_limbs{}
+    {
+        if (num.bit_length() >= Bits)
+            throw std::out_of_range("BigInt is out of range of a Fixed_int");
+        for (size_t i = 0; i < limb_count; i++)
+            m_limbs[i] = num.limb(i);
+        if (num < 0)
+            *this = -*this;
+    }
+
+    static constexpr Fixed_int from_limbs(const Limbs& limbs)
+    {
+        Fixed_int num;
+        num.m_limbs = limbs;
+        return num;
+    }
+    constexpr const Limbs& limbs() const { return m_limbs; }
+    constexpr uint64_t limb(size_t index) const { return m_limbs[index]; }
+
+    BigInt to_big_int() const
+    {
+        Limbs magnitude = is_negative() ? (-*this).m_limbs : m_limbs;
+        BigInt num = BigInt::from_limbs(magnitude.data(), limb_count);
+        return is_negative() ? -num : num;
+    }
+
+    constexpr bool is_negative() const
+    {
+        return m_limbs[limb_count - 1] >> 63;
+    }
+    // bit queries look at the two's complement bits directly, so for
+    // non-negative values they agree with BigInt
+    constexpr size_t bit_length() const { return bit_length_(m_limbs); }
+    constexpr bool test_bit(size_t index) const
+    {
+        return (m_limbs[index / 64] >> (index % 64)) & 1;
+    }
+
+    // Unary arithmetic operators:
+    constexpr Fixed_int operator+() const { return *this; }
+    constexpr Fixed_int operator-() const
+    {
+        Fixed_int result;
+        uint64_t carry = 1;
+        for (size_t i = 0; i < limb_count; i++) {
+            result.m_limbs[i] = ~m_limbs[i] + carry;
+            carry &= result.m_limbs[i] == 0;
+        }
+        return result;
+    }
+
+    // Binary arithmetic operators:
+    friend constexpr Fixed_int operator+(const Fixed_int& a, const Fixed_int& b)
+    {
+        Fixed_int result;
+        add_(result.m_limbs, a.m_limbs, b.m_limbs);
+        return result;
+    }
+    friend constexpr Fixed_int operator-(const Fixed_int& a, const Fixed_int& b)
+    {
+        Fixed_int result;
+        subtract_(result.m_limbs, a.m_limbs, b.m_limbs);
+        return result;
+    }
+    // the low half of a product is the same for signed and unsigned operands
+    friend constexpr Fixed_int operator*(const Fixed_int& a, const Fixed_int& b)
+    {
+        Fixed_int result;
+        for (size_t i = 0; i < limb_count; i++) {
+            uint64_t carry = 0;
+            for (size_t j = 0; i + j < limb_count; j++) {
+                unsigned __int128 product
+                        = (unsigned __int128) a.m_limbs[i] * b.m_limbs[j]
+                        + result.m_limbs[i + j] + carry;
+                result.m_limbs[i + j] = (uint64_t) product;
+                carry = (uint64_t) (product >> 64);
+            }
+        }
+        return result;
+    }
+    friend constexpr Fixed_int operator/(const Fixed_int& a, const Fixed_int& b)
+    {
+        Fixed_int quotient, remainder;
+        divide_(a, b, quotient, remainder);
+        return quotient;
+    }
+    friend constexpr Fixed_int operator%(const Fixed_int& a, const Fixed_int& b)
+    {
+        Fixed_int quotient, remainder;
+        divide_(a, b, quotient, remainder);
+        return remainder;
+    }
+    friend constexpr std::tuple<Fixed_int, Fixed_int> divmod(
+            const Fixed_int& a, const Fixed_int& b)
+    {
+        Fixed_int quotient, remainder;
+        divide_(a, b, quotient, remainder);
+        return { quotient, remainder };
+    }
+
+    // Arithmetic-assignment operators:
+    constexpr Fixed_int& operator+=(const Fixed_int& num)
+    {
+        add_(m_limbs, m_limbs, num.m_limbs);
+        return *this;
+    }
+    constexpr Fixed_int& operator-=(const Fixed_int& num)
+    {
+        subtract_(m_limbs, m_limbs, num.m_limbs);
+        return *this;
+    }
+    constexpr Fixed_int& operator*=(const Fixed_int& num)
+    {
+        return *this = *this * num;
+    }
+    constexpr Fixed_int& operator/=(const Fixed_int& num)
+    {
+        return *this = *this / num;
+    }
+    constexpr Fixed_int& operator%=(const Fixed_int& num)
+    {
+        return *this = *this % num;
+    }
+
+    // Relational operators:
+    friend constexpr bool operator==(const Fixed_int& a, const Fixed_int& b)
+    {
+        for (size_t i = 0; i < limb_count; i++) {
+            if (a.m_limbs[i] != b.m_limbs[i])
+                return false;
+        }
+        return true;
+    }
+    friend constexpr bool operator!=(const Fixed_int& a, const Fixed_int& b)
+    {
+        return !(a == b);
+    }
+    friend constexpr bool operator<(const Fixed_int& a, const Fixed_int& b)
+    {
+        if (a.is_negative() != b.is_negative())
+            return a.is_negative();
+        return compare_unsigned_(a.m_limbs, b.m_limbs) < 0;
+    }
+    friend constexpr bool operator>(const Fixed_int& a, const Fixed_int& b)
+    {
+        return b < a;
+    }
+    friend constexpr bool operator<=(const Fixed_int& a, const Fixed_int& b)
+    {
+        return !(b < a);
+    }
+    friend constexpr bool operator>=(const Fixed_int& a, const Fixed_int& b)
+    {
+        return !(a < b);
+    }
+
+    friend std::ostream& operator<<(std::ostream& out, const Fixed_int& num)
+    {
+        return out << num.to_big_int();
+    }
+
+    // Limb kernels on unsigned values, shared with Fixed_montgomery:
+    static constexpr uint64_t add_(Limbs& result, const Limbs& a, const Limbs& b)
+    {
+        uint64_t carry = 0;
+        for (size_t i = 0; i < limb_count; i++) {
+            unsigned __int128 sum = (unsigned __int128) a[i] + b[i] + carry;
+            result[i] = (uint64_t) sum;
+            carry = (uint64_t) (sum >> 64);
+        }
+        return carry;
+    }
+    static constexpr uint64_t subtract_(
+            Limbs& result, const Limbs& a, const Limbs& b)
+    {
+        uint64_t borrow = 0;
+        for (size_t i = 0; i < limb_count; i++) {
+            unsigned __int128 difference
+                    = (unsigned __int128) a[i] - b[i] - borrow;
+            result[i] = (uint64_t) difference;
+            borrow = (uint64_t) (difference >> 64) & 1;
+        }
+        return borrow;
+    }
+    static constexpr int compare_unsigned_(const Limbs& a, const Limbs& b)
+    {
+        for (size_t i = limb_count; i-- > 0;) {
+            if (a[i] != b[i])
+                return a[i] < b[i] ? -1 : 1;
+        }
+        return 0;
+    }
+    static constexpr size_t bit_length_(const Limbs& num)
+    {
+        for (size_t i = limb_count; i-- > 0;) {
+            if (num[i] != 0)
+                return i * 64 + 64 - __builtin_clzll(num[i]);
+        }
+        return 0;
+    }
+
+    // Shift-and-subtract division of unsigned values. Only as many steps are
+    // taken as the quotient has bits, which keeps the small quotients of
+    // Euclid's algorithm cheap.
+    static constexpr void divide_unsigned_(
+            const Limbs& dividend, const Limbs& divisor, Limbs& quotient,
+            Limbs& remainder)
+    {
+        quotient = Limbs{};
+        remainder = dividend;
+        size_t dividend_bits = bit_length_(dividend);
+        size_t divisor_bits = bit_length_(divisor);
+        if (dividend_bits < divisor_bits)
+            return;
+
+        size_t shift = dividend_bits - divisor_bits;
+        Limbs shifted{};
+        // the carries between limbs are left out of a single limb at compile
+        // time, where the compiler could not tell that they never run
+        for (size_t i = limb_count; i-- > shift / 64;) {
+            shifted[i] = divisor[i - shift / 64] << (shift % 64);
+            if constexpr (limb_count > 1) {
+                if (shift % 64 != 0 && i > shift / 64)
+                    shifted[i]
+                            |= divisor[i - shift / 64 - 1] >> (64 - shift % 64);
+            }
+        }
+
+        for (size_t bit = shift + 1; bit-- > 0;) {
+            if (compare_unsigned_(remainder, shifted) >= 0) {
+                subtract_(remainder, remainder, shifted);
+                quotient[bit / 64] |= uint64_t(1) << (bit % 64);
+            }
+            if constexpr (limb_count > 1) {
+                for (size_t i = 0; i + 1 < limb_count; i++)
+                    shifted[i] = shifted[i] >> 1 | shifted[i + 1] << 63;
+            }
+            shifted[limb_count - 1] >>= 1;
+        }
+    }
+
+private:
+    static constexpr void divide_(
+            const Fixed_int& dividend, const Fixed_int& divisor,
+            Fixed_int& quotient, Fixed_int& remainder)
+    {
+        if (divisor == 0)
+            throw std::logic_error("Attempted division by zero");
+
+        Fixed_int abs_dividend = dividend.is_negative() ? -dividend : dividend;
+        Fixed_int abs_divisor = divisor.is_negative() ? -divisor : divisor;
+        divide_unsigned_(abs_dividend.m_limbs, abs_divisor.m_limbs,
+                         quotient.m_limbs, remainder.m_limbs);
+
+        if (dividend.is_negative() != divisor.is_negative())
+            quotient = -quotient;
+        if (dividend.is_negative())
+            remainder = -remainder;
+    }
+
+    Limbs m_limbs;
+};
+
+// Montgomery arithmetic modulo an odd Fixed_int modulus N with R = 2^Bits,
+// the fixed-width counterpart of Montgomery_context. N must be positive, so
+// that t < 2N in the reduction never overflows the extra limb.
+template<size_t Bits>
+class Fixed_montgomery {
+public:
+    using Int = Fixed_int<Bits>;
+    using Limbs = typename Int::Limbs;
+    static constexpr size_t limb_count = Int::limb_count;
+
+    constexpr explicit Fixed_montgomery(const Int& modulus)
+        : m_n(modulus.limbs()), m_r_mod_n{}, m_r2_mod_n{}, m_n_prime(0)
+    {
+        if (modulus <= 0 || modulus.limb(0) % 2 == 0)
+            throw std::invalid_argument("Montgomery modulus must be odd.");
+
+        uint64_t inv = m_n[0];
+        for (int i = 0; i < 5; i++)
+            inv *= 2 - m_n[0] * inv;
+        m_n_prime = 0 - inv;
+
+        // R mod N = (R - N) mod N. With Bits = odd * 2^k, doubling it `odd`
+        // times gives 2^odd * R, and k Montgomery squarings then raise the
+        // power of two to Bits, i.e. R^2 mod N. N < 2^(Bits - 1) keeps each
+        // doubling within Bits.
+        Limbs quotient{};
+        Int::divide_unsigned_((-modulus).limbs(), m_n, quotient, m_r_mod_n);
+        size_t odd = Bits, squarings = 0;
+        for (; odd % 2 == 0; odd /= 2)
+            squarings++;
+        m_r2_mod_n = m_r_mod_n;
+        for (size_t i = 0; i < odd; i++) {
+            Int::add_(m_r2_mod_n, m_r2_mod_n, m_r2_mod_n);
+            m_r2_mod_n = reduce_once_(m_r2_mod_n);
+        }
+        for (size_t i = 0; i < squarings; i++)
+            m_r2_mod_n = mont_mul_(m_r2_mod_n, m_r2_mod_n);
+    }
+
+    constexpr Int modulus() const { return Int::from_limbs(m_n); }
+    constexpr Int to_mont(const Int& a) const
+    {
+        Int reduced = a;
+        if (a < 0 || Int::compare_unsigned_(a.limbs(), m_n) >= 0) {
+            reduced = a % modulus();
+            if (reduced < 0)
+                reduced += modulus();
+        }
+        return Int::from_limbs(mont_mul_(reduced.limbs(), m_r2_mod_n));
+    }
+    constexpr Int from_mont(const Int& a) const
+    {
+        return Int::from_limbs(mont_mul_(a.limbs(), Int(1).limbs()));
+    }
+    constexpr Int mul(const Int& a, const Int& b) const
+    {
+        return Int::from_limbs(mont_mul_(a.limbs(), b.limbs()));
+    }
+    // the exponent may be any type with bit_length() and test_bit(), so a
+    // BigInt exponent needs no conversion
+    template<typename Exp_type>
+    constexpr Int pow(const Int& base, const Exp_type& exp) const
+    {
+        if (exp < 0)
+            throw std::invalid_argument("Exponent must be non-negative.");
+
+        Limbs x = to_mont(base).limbs();
+        Limbs acc = m_r_mod_n;
+        for (size_t i = exp.bit_length(); i-- > 0;) {
+            acc = mont_mul_(acc, acc);
+            if (exp.test_bit(i))
+                acc = mont_mul_(acc, x);
+        }
+        return from_mont(Int::from_limbs(acc));
+    }
+
+private:
+    constexpr Limbs reduce_once_(const Limbs& a) const
+    {
+        Limbs result = a;
+        if (Int::compare_unsigned_(result, m_n) >= 0)
+            Int::subtract_(result, result, m_n);
+        return result;
+    }
+
+    // CIOS: a * b / R mod N, as in Montgomery_context::mont_mul
+    constexpr Limbs mont_mul_(const Limbs& a, const Limbs& b) const
+    {
+        std::array<uint64_t, limb_count + 2> t{};
+
+        for (size_t i = 0; i < limb_count; i++) {
+            uint64_t carry = 0;
+            for (size_t j = 0; j < limb_count; j++) {
+                unsigned __int128 sum = (unsigned __int128) a[j] * b[i]
+                                        + t[j] + carry;
+                t[j] = (uint64_t) sum;
+                carry = (uint64_t) (sum >> 64);
+            }
+            unsigned __int128 sum = (unsigned __int128) t[limb_count] + carry;
+            t[limb_count] = (uint64_t) sum;
+            t[limb_count + 1] = (uint64_t) (sum >> 64);
+
+            uint64_t m = t[0] * m_n_prime;
+            sum = (unsigned __int128) m * m_n[0] + t[0];
+            carry = (uint64_t) (sum >> 64);
+            for (size_t j = 1; j < limb_count; j++) {
+                sum = (unsigned __int128) m * m_n[j] + t[j] + carry;
+                t[j - 1] = (uint64_t) sum;
+                carry = (uint64_t) (sum >> 64);
+            }
+            sum = (unsigned __int128) t[limb_count] + carry;
+            t[limb_count - 1] = (uint64_t) sum;
+            t[limb_count] = t[limb_count + 1] + (uint64_t) (sum >> 64);
+        }
+
+        // t < 2N: subtract N unless that borrows out of t, selecting the
+        // result with a mask rather than a branch that mispredicts half the
+        // time
+        Limbs result{}, reduced{};
+        for (size_t i = 0; i < limb_count; i++)
+            result[i] = t[i];
+        uint64_t borrow = Int::subtract_(reduced, result, m_n);
+        uint64_t keep = 0 - (borrow & (t[limb_count] ^ 1));
+        for (size_t i = 0; i < limb_count; i++)
+            result[i] = (result[i] & keep) | (reduced[i] & ~keep);
+        return result;
+    }
+
+    Limbs m_n;
+    Limbs m_r_mod_n;
+    Limbs m_r2_mod_n;
+    uint64_t m_n_prime;
+};
+
+// Fixed-width mod_exp: Montgomery exponentiation for odd moduli, and
+// square-and-multiply over double-width products otherwise.
+template<size_t Bits>
+constexpr Fixed_int<Bits> mod_exp(
+        const Fixed_int<Bits>& a, const Fixed_int<Bits>& e,
+        const Fixed_int<Bits>& m)
+{
+    if (m <= 0)
+        throw std::invalid_argument("Modulus must be positive.");
+    if (e < 0)
+        throw std::invalid_argument("Exponent must be non-negative.");
+    if (m.limb(0) % 2 == 1 && m > 1)
+        return Fixed_montgomery<Bits>(m).pow(a, e);
+
+    using Wide = Fixed_int<2 * Bits>;
+    typename Wide::Limbs wide_m{};
+    for (size_t i = 0; i < Fixed_int<Bits>::limb_count; i++)
+        wide_m[i] = m.limb(i);
+    Wide modulus = Wide::from_limbs(wide_m);
+
+    auto narrow = [](const Wide& num) {
+        typename Fixed_int<Bits>::Limbs limbs{};
+        for (size_t i = 0; i < Fixed_int<Bits>::limb_count; i++)
+            limbs[i] = num.limb(i);
+        return Fixed_int<Bits>::from_limbs(limbs);
+    };
+    auto widen = [](const Fixed_int<Bits>& num) {
+        typename Wide::Limbs limbs{};
+        for (size_t i = 0; i < Fixed_int<Bits>::limb_count; i++)
+            limbs[i] = num.limb(i);
+        return Wide::from_limbs(limbs);
+    };
+
+    Fixed_int<Bits> base = a % m;
+    if (base < 0)
+        base += m;
+    Fixed_int<Bits> result = 1 % m;
+    for (size_t i = e.bit_length(); i-- > 0;) {
+        result = narrow((widen(result) * widen(result)) % modulus);
+        if (e.test_bit(i))
+            result = narrow((widen(result) * widen(base)) % modulus);
+    }
+    return result;
+}
+
+}  // namespace petliukh::cryptography
@@ -2,6 +2,8 @@
 #include "cipher_base.hpp"
 
 #include <BigInt.hpp>
+#include "codebook_cache.hpp"
+#include <optional>
 #include <vector>
 
 namespace petliukh::cryptography {
@@ -35,9 +37,13 @@ public:
     void generate_rand_key(size_t inc_digits);
     void set_separator(char sep);
     const Key& get_key() const;
+    // Caches up to `capacity` ciphertext tokens, which are the same for a
+    // character under one key; 0 turns it off.
+    void set_codebook_capacity(size_t capacity);
 
 private:
     Key m_key;
+    std::optional<Codebook_cache> m_codebook;
 };
 
 std::vector<BigInt> generate_superincreasing_sequence(
@@ -1,30 +1,49 @@
 #pragma once
 
+#include <optional>
 #include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
 #include "BigInt.hpp"
+#include "fixed_int.hpp"
 
 namespace petliukh::cryptography {
 
-// Function for extended Euclidean Algorithm
+// Quotient and remainder in one call, for types that have no divmod of their
+// own; BigInt's and Fixed_int's are preferred by overload resolution.
+template<typename Int_type>
+std::tuple<Int_type, Int_type> divmod(const Int_type& a, const Int_type& b)
+{
+    return { a / b, a % b };
+}
+
+// Extended Euclidean algorithm: returns gcd(a, b) and stores Bezout
+// coefficients with a * x + b * y = gcd(a, b). The coefficients are carried
+// along with the remainders, so one pass with one division per step is
+// enough.
 template<typename Int_type>
 Int_type gcd_extended(Int_type a, Int_type b, Int_type* x, Int_type* y)
 {
-    // Base Case
-    if (a == 0) {
-        *x = 0, *y = 1;
-        return b;
-    }
+    // invariants: a = x0 * A + y0 * B and b = x1 * A + y1 * B
+    Int_type x0 = 1, y0 = 0, x1 = 0, y1 = 1;
 
-    // To store results of recursive call
-    Int_type x1, y1;
-    Int_type gcd = gcd_extended(b % a, a, &x1, &y1);
+    while (b != 0) {
+        auto [q, r] = divmod(a, b);
+        a = std::move(b);
+        b = std::move(r);
 
-    // Update x and y using results of recursive
-    // call
-    *x = y1 - (b / a) * x1;
-    *y = x1;
+        Int_type t = x0 - q * x1;
+        x0 = std::move(x1);
+        x1 = std::move(t);
+        t = y0 - q * y1;
+        y0 = std::move(y1);
+        y1 = std::move(t);
+    }
 
-    return gcd;
+    *x = x0;
+    *y = y0;
+    return a;
 }
 
 // Function to find modulo inverse of a
@@ -42,8 +61,142 @@ Int_type mod_inverse(Int_type A, Int_type M)
     }
 }
 
-bool is_prime(const BigInt& n);
+// Modular inverse of a BigInt. Moduli of up to 126 bits run the extended
+// Euclidean algorithm on native or fixed-width integers instead of BigInt.
+BigInt mod_inverse(const BigInt& A, const BigInt& M);
+
+// Montgomery arithmetic modulo a fixed odd modulus N, with R = 2^(64 * limbs
+// of N). R mod N, R^2 mod N and N' = -N^-1 mod 2^64 are computed once, after
+// which multiplication needs no division. `mul` and `sqr` take and return
+// values in Montgomery form (a * R mod N), `pow` works on ordinary residues
+// and runs on the fixed-width kernels when N has at most 127 bits.
+class Montgomery_context {
+public:
+    explicit Montgomery_context(const BigInt& modulus);
+
+    const BigInt& modulus() const;
+    BigInt to_mont(const BigInt& a) const;
+    BigInt from_mont(const BigInt& a) const;
+    BigInt mul(const BigInt& a, const BigInt& b) const;
+    BigInt sqr(const BigInt& a) const;
+    BigInt pow(const BigInt& base, const BigInt& exp) const;
+
+private:
+    std::vector<uint64_t> to_limbs(const BigInt& a) const;
+    void mont_mul(
+            const uint64_t* a, const uint64_t* b, uint64_t* result) const;
+
+    BigInt m_modulus;
+    std::vector<uint64_t> m_n;
+    std::vector<uint64_t> m_r_mod_n;
+    std::vector<uint64_t> m_r2_mod_n;
+    uint64_t m_n_prime;
+    std::optional<Fixed_montgomery<64>> m_fixed64;
+    std::optional<Fixed_montgomery<128>> m_fixed128;
+};
+
+// Barrett reduction modulo a fixed modulus N of k limbs. mu = floor(2^(128k)
+// / N) is computed once, after which a value below 2^(128k), such as the
+// product of two residues, is reduced with two multiplications and at most
+// two subtractions instead of a long division. Larger values fall back to `%`.
+class Barrett_reducer {
+public:
+    explicit Barrett_reducer(const BigInt& modulus);
+
+    const BigInt& modulus() const;
+    BigInt reduce(const BigInt& a) const;
+    BigInt mul(const BigInt& a, const BigInt& b) const;
+
+private:
+    BigInt m_modulus;
+    BigInt m_mu;
+    size_t m_k;
+};
+
+// Exponentiation of a fixed base modulo a fixed odd modulus with the Lim-Lee
+// comb method. An exponent of up to t bits is viewed as h rows of a = t / h
+// bits, and the 2^h products of base^(2^(a * j)) over every subset of rows
+// are precomputed once, in Montgomery form. `pow` then takes a squarings and
+// at most a multiplications, against t squarings for a plain exponentiation.
+// Moduli of up to 127 bits use the fixed-width kernels. Exponents longer than
+// `max_exp_bits` (the length of the modulus by default) fall back to mod_exp.
+class Fixed_base_exp {
+public:
+    Fixed_base_exp(
+            const BigInt& base, const BigInt& modulus, size_t max_exp_bits = 0);
+
+    const BigInt& base() const;
+    const BigInt& modulus() const;
+    BigInt pow(const BigInt& exp) const;
+
+private:
+    template<typename Context, typename Value>
+    struct Comb {
+        Context context;
+        std::vector<Value> table;
+    };
+
+    BigInt m_base;
+    BigInt m_modulus;
+    size_t m_rows;
+    size_t m_spacing;
+    std::optional<Comb<Fixed_montgomery<64>, Fixed_int<64>>> m_comb64;
+    std::optional<Comb<Fixed_montgomery<128>, Fixed_int<128>>> m_comb128;
+    std::optional<Comb<Montgomery_context, BigInt>> m_comb;
+};
+
+// Jacobi symbol (a / n) for an odd positive n.
+int jacobi(BigInt a, BigInt n);
+
+enum class Primality_test { miller_rabin, bpsw };
+
+// Probabilistic primality test. After trial division by a few small primes,
+// numbers below 2^64 are decided exactly by Miller-Rabin with a fixed set of
+// bases. Larger ones get `rounds` Miller-Rabin tests with random bases, which
+// let a composite through with probability below 4^-rounds, or with
+// Primality_test::bpsw the Baillie-PSW test (a base-2 strong probable prime
+// test followed by a strong Lucas test), which has no known counterexample
+// and ignores `rounds`.
+bool is_prime(
+        const BigInt& n, size_t rounds = 25,
+        Primality_test test = Primality_test::miller_rabin);
+
+// Incremental sieve over the odd numbers from a starting point upwards or
+// downwards. The residues of the current segment start modulo the odd primes
+// below 2^15 are computed once and then advanced with native arithmetic, and
+// each segment of candidates is sieved by marking the multiples of those
+// primes in a bitmap. `next` returns the next candidate that survives, which
+// removes about nine in ten odd numbers before any primality test. Candidates
+// below 2^32 are not sieved and only skip even numbers. With `sophie_germain`
+// set, candidates q for which 2q + 1 has a small prime factor are removed as
+// well, for the search of safe primes 2q + 1.
+class Prime_sieve {
+public:
+    enum class Direction { up, down };
+
+    explicit Prime_sieve(
+            const BigInt& start, Direction direction = Direction::up,
+            bool sophie_germain = false);
+
+    BigInt next();
+
+private:
+    void sieve_segment();
+
+    BigInt m_base;
+    Direction m_direction;
+    bool m_sophie_germain;
+    std::vector<uint32_t> m_residues;
+    std::vector<bool> m_composite;
+    size_t m_index;
+};
+
+// Smallest prime above n.
+BigInt next_prime(const BigInt& n);
+// Largest prime below n, which must be greater than 2.
+BigInt prev_prime(const BigInt& n);
+// Largest prime below n, or 2 if there is none.
 BigInt nearest_prime(BigInt n);
-BigInt mod_exp(const BigInt& a, BigInt e, const BigInt& m);
+BigInt mod_exp(const BigInt& a, const BigInt& e, const BigInt& m);
 
 }  // namespace petliukh::cryptography
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+#include "BigInt.hpp"
+#include "numeric_utils.hpp"
+
+namespace petliukh::cryptography {
+
+struct Prime_search_options {
+    // number of decimal digits of the random starting points
+    size_t digits = 10;
+    // number of primes to find
+    size_t count = 1;
+    // worker threads, or 0 for one per hardware thread
+    size_t threads = 0;
+    // seed of the starting points, or a fresh random one if empty
+    std::optional<uint64_t> seed;
+    // passed on to is_prime
+    size_t rounds = 25;
+    Primality_test test = Primality_test::miller_rabin;
+    // look for safe primes 2q + 1 with q prime instead
+    bool safe = false;
+};
+
+struct Prime_search_result {
+    std::vector<BigInt> primes;
+    uint64_t seed;
+};
+
+// Finds `count` primes, the i-th of which is the smallest prime not below the
+// i-th random number of `digits` digits drawn from a generator seeded with
+// `seed`. The odd numbers from each starting point are split into short
+// windows that the workers take in turn, sieve and test, with the workers
+// spread over all the primes that are still being searched for. Once a window
+// yields a prime, the windows after it are abandoned, while those before it
+// are still finished, so the result depends only on the seed and the search
+// can be repeated with the returned one. Safe primes are searched for by
+// scanning q from half of each starting point, with q and 2q + 1 sieved
+// together.
+Prime_search_result find_primes(const Prime_search_options& options);
+
+}  // namespace petliukh::cryptography
@@ -1,5 +1,11 @@
+#pragma once
 #include "cipher_base.hpp"
 #include "BigInt.hpp"
+#include "codebook_cache.hpp"
+#include "numeric_utils.hpp"
+
+#include <optional>
+#include <vector>
 
 namespace petliukh::cryptography {
 
@@ -12,10 +18,30 @@ public:
         BigInt phi;
         BigInt e;
         BigInt d;
+        // CRT exponents d mod (p - 1), d mod (q - 1) and q^-1 mod p
+        BigInt d_p;
+        BigInt d_q;
+        BigInt q_inv;
+
+        // further primes of a multi-prime key, with the CRT exponent
+        // d mod (r - 1) and coefficient (p * q * ...)^-1 mod r of each
+        struct Prime_info {
+            BigInt r;
+            BigInt d;
+            BigInt t;
+        };
+        std::vector<Prime_info> other_primes;
 
         std::string to_string() const;
     };
 
+    // per_character encrypts every UTF-16 code unit on its own. block packs
+    // the message behind an 8-byte length prefix into blocks of as many
+    // bytes as fit below N, one exponentiation per block. Raw bytes are
+    // always encrypted in blocks, each written as a number of the byte
+    // length of N.
+    enum class Mode { per_character, block };
+
     Rsa_cipher();
     virtual ~Rsa_cipher();
     virtual std::u16string encrypt(const std::u16string& message) override;
@@ -26,11 +52,39 @@ public:
     virtual void set_lang(const std::u16string& lang) override;
     virtual void set_lang(const Language& lang) override;
     Key get_key() const;
-    void generate_rand_key(size_t key_digits = 10);
+    void set_mode(Mode mode);
+    // Caches up to `capacity` ciphertext tokens of the per-character mode,
+    // which are the same for a character under one key; 0 turns it off.
+    void set_codebook_capacity(size_t capacity);
+    // key_digits is the length of p and q in a two-prime key. With more
+    // primes N keeps about the same length and the primes get shorter; they
+    // must keep at least two digits.
+    void generate_rand_key(size_t key_digits = 10, size_t num_primes = 2);
 
 private:
+    // A prime factor of N, in the order of Garner's recombination: q, p and
+    // then the other primes.
+    struct Crt_factor_ {
+        Montgomery_context mont;
+        BigInt exponent;
+        // inverse of the product of the preceding factors, in Montgomery
+        // form, and that product
+        BigInt coefficient_mont;
+        BigInt product;
+    };
+
+    void derive_key_();
+    const Montgomery_context& mont_() const;
+    BigInt decrypt_number_(const BigInt& c) const;
+    size_t block_size_() const;
+    std::vector<BigInt> encrypt_blocks_(const std::string& bytes) const;
+    std::string decrypt_blocks_(const std::vector<BigInt>& blocks) const;
 
     Key m_key;
+    Mode m_mode = Mode::per_character;
+    std::optional<Codebook_cache> m_codebook;
+    std::optional<Montgomery_context> m_mont;
+    std::vector<Crt_factor_> m_crt;
 };
 
 }  // namespace petliukh::cryptography
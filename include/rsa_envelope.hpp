@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include "rsa_cipher.hpp"
+
+namespace petliukh::cryptography {
+
+// RSA-OAEP with SHA-256 for the digest and MGF1, through OpenSSL, for short
+// secrets such as session keys. The padding is random, so the same message
+// encrypts differently every time, unlike the deterministic block mode of
+// Rsa_cipher. The ciphertext has the byte length of N, which must exceed
+// the message by at least 66 bytes. Decryption throws std::invalid_argument
+// for a ciphertext that does not unpad.
+std::string rsa_oaep_encrypt(const Rsa_cipher& rsa, const std::string& message);
+std::string rsa_oaep_decrypt(
+        const Rsa_cipher& rsa, const std::string& ciphertext);
+
+// Hybrid encryption for bulk data: the payload is encrypted with AES-256-GCM
+// under a fresh random session key, and only that key goes through RSA, with
+// OAEP, so N needs at least 98 bytes. The envelope describes itself:
+//
+//     "RSAE" | version (1) | cipher id (1) | key length (4) | iv length (1)
+//     | tag length (1) | RSA-encrypted key | iv | ciphertext | tag
+//
+// with lengths big-endian. The header and the encrypted key are
+// authenticated along with the payload.
+std::string rsa_envelope_seal(
+        const Rsa_cipher& rsa, const std::string& payload);
+// Throws std::invalid_argument for a malformed or tampered envelope.
+std::string rsa_envelope_open(
+        const Rsa_cipher& rsa, const std::string& envelope);
+
+}  // namespace petliukh::cryptography
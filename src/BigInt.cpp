@@ -6,7 +6,36 @@
     ===========================================================================
 */
 
-#include <tuple>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+using Limbs = BigInt::Limbs;
+using Double_limb = unsigned __int128;
+
+// largest power of 10 that fits in a limb, used for decimal conversion
+const uint64_t DECIMAL_CHUNK_BASE = 10000000000000000000ULL;
+const size_t DECIMAL_CHUNK_DIGITS = 19;
+
+// multiplication tiers, by the length in limbs of the shorter operand:
+// schoolbook below KARATSUBA_THRESHOLD, then Karatsuba, then Toom-Cook 3-way,
+// then a number-theoretic transform. The crossovers were measured on x86-64
+// (g++ -O2) with balanced random operands of the same length: Toom-3 starts
+// to pay off at about 512 limbs and the transform at about 16384, where the
+// tiers on either side are within a few percent of each other.
+const size_t KARATSUBA_THRESHOLD = 32;
+const size_t TOOM3_THRESHOLD = 512;
+const size_t NTT_THRESHOLD = 16384;
+
+// decimal conversion splits numbers in halves at powers of 10^19 once they are
+// longer than these; below them the chunk-at-a-time loops are faster.
+// Divisions by a power of ten switch from Knuth's algorithm to multiplication
+// by a precomputed reciprocal at RECIPROCAL_THRESHOLD limbs of the power.
+const size_t PARSE_SPLIT_THRESHOLD = 256 * DECIMAL_CHUNK_DIGITS;
+const size_t PRINT_SPLIT_THRESHOLD = 32;
+const size_t RECIPROCAL_THRESHOLD = 256;
 
 /*
     is_valid_number
@@ -14,7 +43,7 @@
     Checks whether the given string is a valid integer.
 */
 
-bool is_valid_number(const std::string& num)
+bool is_valid_number(std::string_view num)
 {
     for (char digit : num)
         if (digit < '0' or digit > '9')
@@ -26,87 +55,755 @@ bool is_valid_number(const std::string& num)
 /*
     strip_leading_zeroes
     --------------------
-    Strip the leading zeroes from a number represented as a string.
+    Strip the leading zero limbs from a magnitude, so that zero has no limbs.
 */
 
-void strip_leading_zeroes(std::string& num)
+void strip_leading_zeroes(Limbs& num)
 {
-    size_t i;
-    for (i = 0; i < num.size(); i++)
-        if (num[i] != '0')
-            break;
+    while (!num.empty() and num.back() == 0)
+        num.pop_back();
+}
 
-    if (i == num.size())
-        num = "0";
-    else
-        num = num.substr(i);
+/*
+    to_double_limb
+    --------------
+    Returns a magnitude of at most two limbs as a native 128-bit integer.
+*/
+
+Double_limb to_double_limb(const Limbs& num)
+{
+    Double_limb result = 0;
+    for (size_t i = num.size(); i-- > 0;)
+        result = (result << 64) | num[i];
+
+    return result;
 }
 
 /*
-    add_leading_zeroes
+    assign_double_limb
     ------------------
-    Adds a given number of leading zeroes to a string-represented integer `num`.
+    Stores a native 128-bit integer in `num` as a stripped magnitude.
 */
 
-void add_leading_zeroes(std::string& num, size_t num_zeroes)
+void assign_double_limb(Limbs& num, Double_limb value)
 {
-    num = std::string(num_zeroes, '0') + num;
+    num.clear();
+    for (; value != 0; value >>= 64)
+        num.push_back((uint64_t) value);
+}
+
+/*
+    gcd_double_limb
+    ---------------
+    Returns the GCD of two native 128-bit integers using the binary GCD
+    algorithm, which needs only shifts and subtractions.
+*/
+
+Double_limb gcd_double_limb(Double_limb num1, Double_limb num2)
+{
+    auto trailing_zeroes = [](Double_limb num) {
+        uint64_t low = (uint64_t) num;
+        return low != 0 ? __builtin_ctzll(low)
+                        : 64 + __builtin_ctzll((uint64_t) (num >> 64));
+    };
+
+    if (num1 == 0)
+        return num2;
+    if (num2 == 0)
+        return num1;
+
+    int shift = trailing_zeroes(num1 | num2);
+    num1 >>= trailing_zeroes(num1);
+    while (num2 != 0) {
+        num2 >>= trailing_zeroes(num2);
+        if (num1 > num2)
+            std::swap(num1, num2);
+        num2 -= num1;
+    }
+
+    return num1 << shift;
+}
+
+/*
+    compare_magnitudes
+    ------------------
+    Returns a negative value, zero or a positive value when the magnitude `num1`
+    is less than, equal to or greater than the magnitude `num2`.
+*/
+
+int compare_magnitudes(
+        const uint64_t* num1, size_t size1, const uint64_t* num2, size_t size2)
+{
+    if (size1 != size2)
+        return size1 < size2 ? -1 : 1;
+    for (size_t i = size1; i-- > 0;)
+        if (num1[i] != num2[i])
+            return num1[i] < num2[i] ? -1 : 1;
+
+    return 0;
+}
+
+int compare_magnitudes(const Limbs& num1, const Limbs& num2)
+{
+    return compare_magnitudes(num1.data(), num1.size(), num2.data(), num2.size());
+}
+
+/*
+    add_limbs
+    ---------
+    Stores `larger + smaller` in the first `larger_size` limbs of `result` and
+    returns the carry out of the top limb. `result` may alias `larger`.
+    NOTE: `larger_size` must not be less than `smaller_size`.
+*/
+
+uint64_t add_limbs(
+        uint64_t* result, const uint64_t* larger, size_t larger_size,
+        const uint64_t* smaller, size_t smaller_size)
+{
+    uint64_t carry = 0;
+    size_t i = 0;
+    for (; i < smaller_size; i++) {
+        Double_limb sum = (Double_limb) larger[i] + smaller[i] + carry;
+        result[i] = (uint64_t) sum;
+        carry = (uint64_t) (sum >> 64);
+    }
+    for (; i < larger_size; i++) {
+        result[i] = larger[i] + carry;
+        carry = carry and result[i] == 0;
+    }
+
+    return carry;
+}
+
+/*
+    subtract_limbs
+    --------------
+    Stores `larger - smaller` in the first `larger_size` limbs of `result` and
+    returns the borrow out of the top limb. `result` may alias `larger`.
+    NOTE: `larger_size` must not be less than `smaller_size`.
+*/
+
+uint64_t subtract_limbs(
+        uint64_t* result, const uint64_t* larger, size_t larger_size,
+        const uint64_t* smaller, size_t smaller_size)
+{
+    uint64_t borrow = 0;
+    size_t i = 0;
+    for (; i < smaller_size; i++) {
+        uint64_t difference = larger[i] - smaller[i];
+        uint64_t next_borrow = larger[i] < smaller[i];
+        next_borrow |= difference < borrow;
+        result[i] = difference - borrow;
+        borrow = next_borrow;
+    }
+    for (; i < larger_size; i++) {
+        uint64_t next_borrow = borrow and larger[i] == 0;
+        result[i] = larger[i] - borrow;
+        borrow = next_borrow;
+    }
+
+    return borrow;
 }
 
 /*
-    add_trailing_zeroes
+    multiply_schoolbook
     -------------------
-    Adds a given number of trailing zeroes to a string-represented integer
-   `num`.
+    Stores the product of two magnitudes in `result`, which must hold
+    `size1 + size2` zeroed limbs.
 */
 
-void add_trailing_zeroes(std::string& num, size_t num_zeroes)
+void multiply_schoolbook(
+        uint64_t* result, const uint64_t* num1, size_t size1,
+        const uint64_t* num2, size_t size2)
 {
-    num += std::string(num_zeroes, '0');
+    for (size_t i = 0; i < size1; i++) {
+        uint64_t carry = 0;
+        for (size_t j = 0; j < size2; j++) {
+            Double_limb product
+                    = (Double_limb) num1[i] * num2[j] + result[i + j] + carry;
+            result[i + j] = (uint64_t) product;
+            carry = (uint64_t) (product >> 64);
+        }
+        result[i + size2] = carry;
+    }
 }
 
 /*
-    get_larger_and_smaller
+    karatsuba_scratch_size
     ----------------------
-    Identifies the given string-represented integers as `larger` and `smaller`,
-    padding the smaller number with leading zeroes to make it equal in length to
-    the larger number.
+    Returns the number of scratch limbs that `multiply_karatsuba` needs when
+    the longer operand has `size` limbs: every level of the recursion keeps the
+    two operand sums and the middle product, and the deepest sub-product is at
+    most half the operand plus one limb.
 */
 
-std::tuple<std::string, std::string>
-get_larger_and_smaller(const std::string& num1, const std::string& num2)
+size_t karatsuba_scratch_size(size_t size)
 {
-    std::string larger, smaller;
-    if (num1.size() > num2.size()
-        or (num1.size() == num2.size() and num1 > num2)) {
-        larger = num1;
-        smaller = num2;
-    } else {
-        larger = num2;
-        smaller = num1;
+    size_t total = 0;
+    while (size >= KARATSUBA_THRESHOLD) {
+        size_t half = (size + 1) / 2;
+        total += 4 * half + 4;
+        size = half + 1;
     }
 
-    // pad the smaller number with zeroes
-    add_leading_zeroes(smaller, larger.size() - smaller.size());
+    return total;
+}
+
+/*
+    multiply_karatsuba
+    ------------------
+    Stores the product of two magnitudes in `result`, which must hold
+    `size1 + size2` zeroed limbs, using Karatsuba's algorithm for operands
+    above `KARATSUBA_THRESHOLD` limbs. All temporaries are carved out of
+    `scratch`, which must hold `karatsuba_scratch_size` limbs for the longer
+    operand.
+*/
+
+void multiply_karatsuba(
+        uint64_t* result, const uint64_t* num1, size_t size1,
+        const uint64_t* num2, size_t size2, uint64_t* scratch)
+{
+    // make `num1` the longer operand
+    if (size1 < size2) {
+        std::swap(num1, num2);
+        std::swap(size1, size2);
+    }
+    if (size2 < KARATSUBA_THRESHOLD) {
+        multiply_schoolbook(result, num1, size1, num2, size2);
+        return;
+    }
 
-    return std::make_tuple(larger, smaller);
+    size_t half = (size1 + 1) / 2;
+    if (size2 <= half) {
+        // unbalanced operands: multiply `num1` in pieces as long as `num2`
+        uint64_t* partial = scratch;
+        for (size_t i = 0; i < size1; i += size2) {
+            size_t piece = std::min(size2, size1 - i);
+            std::fill(partial, partial + piece + size2, 0);
+            multiply_karatsuba(partial, num1 + i, piece, num2, size2,
+                               scratch + 2 * size2);
+            add_limbs(result + i, result + i, size1 + size2 - i, partial,
+                      piece + size2);
+        }
+        return;
+    }
+
+    // num1 = num1_high * B^half + num1_low, likewise for num2
+    size_t high_size1 = size1 - half, high_size2 = size2 - half;
+    const uint64_t* num1_high = num1 + half;
+    const uint64_t* num2_high = num2 + half;
+
+    uint64_t* sum1 = scratch;
+    uint64_t* sum2 = sum1 + half + 1;
+    uint64_t* prod_mid = sum2 + half + 1;
+    uint64_t* next_scratch = prod_mid + 2 * half + 2;
+
+    sum1[half] = add_limbs(sum1, num1, half, num1_high, high_size1);
+    sum2[half] = add_limbs(sum2, num2, half, num2_high, high_size2);
+
+    // the low and high products are formed directly in their place in the
+    // result, which does not overlap
+    uint64_t* prod_low = result;
+    uint64_t* prod_high = result + 2 * half;
+    multiply_karatsuba(prod_low, num1, half, num2, half, next_scratch);
+    multiply_karatsuba(prod_high, num1_high, high_size1, num2_high,
+                       high_size2, next_scratch);
+    std::fill(prod_mid, prod_mid + 2 * half + 2, 0);
+    multiply_karatsuba(prod_mid, sum1, half + 1, sum2, half + 1,
+                       next_scratch);
+
+    // prod_mid = (num1_high + num1_low) * (num2_high + num2_low)
+    //            - prod_high - prod_low
+    size_t mid_size = 2 * half + 2;
+    subtract_limbs(prod_mid, prod_mid, mid_size, prod_low, 2 * half);
+    subtract_limbs(prod_mid, prod_mid, mid_size, prod_high,
+                   high_size1 + high_size2);
+    while (mid_size > 0 and prod_mid[mid_size - 1] == 0)
+        mid_size--;
+
+    add_limbs(result + half, result + half, size1 + size2 - half, prod_mid,
+              mid_size);
 }
 
 /*
-    is_power_of_10
-    ----------------------
-    Checks whether a string-represented integer is a power of 10.
+    ntt_reduce
+    ----------
+    Reduces a 128-bit integer modulo the NTT prime P = 2^64 - 2^32 + 1, using
+    2^64 = 2^32 - 1 and 2^96 = -1 (mod P).
 */
 
-bool is_power_of_10(const std::string& num)
+const uint64_t NTT_PRIME = 0xffffffff00000001ULL;
+const uint64_t NTT_EPSILON = 0xffffffffULL;  // 2^64 mod P
+const uint64_t NTT_GENERATOR = 7;  // generates the multiplicative group mod P
+
+uint64_t ntt_reduce(Double_limb num)
 {
-    if (num[0] != '1')
-        return false;
-    for (size_t i = 1; i < num.size(); i++)
-        if (num[i] != '0')
-            return false;
+    uint64_t low = (uint64_t) num, high = (uint64_t) (num >> 64);
+    uint64_t high_high = high >> 32, high_low = high & NTT_EPSILON;
+
+    // the corrections are masks rather than branches: on random data the
+    // branches would be mispredicted half of the time
+    uint64_t result = low - high_high;
+    result -= NTT_EPSILON & (0 - (uint64_t) (low < high_high));
+    uint64_t term = high_low * NTT_EPSILON;
+    result += term;
+    result += NTT_EPSILON & (0 - (uint64_t) (result < term));
+    result -= NTT_PRIME & (0 - (uint64_t) (result >= NTT_PRIME));
+
+    return result;
+}
+
+uint64_t ntt_multiply(uint64_t num1, uint64_t num2)
+{
+    return ntt_reduce((Double_limb) num1 * num2);
+}
+
+uint64_t ntt_power(uint64_t base, uint64_t exp)
+{
+    uint64_t result = 1;
+    for (; exp; exp >>= 1) {
+        if (exp & 1)
+            result = ntt_multiply(result, base);
+        base = ntt_multiply(base, base);
+    }
+
+    return result;
+}
+
+/*
+    ntt_transform
+    -------------
+    In-place iterative Cooley-Tukey transform modulo NTT_PRIME of a sequence
+    whose length is a power of two (at most 2^32).
+*/
+
+void ntt_transform(std::vector<uint64_t>& values, bool inverse)
+{
+    size_t size = values.size();
+    for (size_t i = 1, j = 0; i < size; i++) {
+        size_t bit = size >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if (i < j)
+            std::swap(values[i], values[j]);
+    }
+
+    std::vector<uint64_t> roots;
+    for (size_t length = 2; length <= size; length <<= 1) {
+        uint64_t root = ntt_power(NTT_GENERATOR, (NTT_PRIME - 1) / length);
+        if (inverse)
+            root = ntt_power(root, NTT_PRIME - 2);
+        size_t half = length / 2;
+        roots.resize(half);
+        roots[0] = 1;
+        for (size_t j = 1; j < half; j++)
+            roots[j] = ntt_multiply(roots[j - 1], root);
+
+        for (size_t i = 0; i < size; i += length) {
+            for (size_t j = 0; j < half; j++) {
+                uint64_t u = values[i + j];
+                uint64_t v = ntt_multiply(values[i + j + half], roots[j]);
+                uint64_t sum = u + v;
+                sum -= NTT_PRIME
+                        & (0 - (uint64_t) ((sum < u) | (sum >= NTT_PRIME)));
+                uint64_t difference = u - v;
+                difference += NTT_PRIME & (0 - (uint64_t) (u < v));
+                values[i + j] = sum;
+                values[i + j + half] = difference;
+            }
+        }
+    }
+
+    if (inverse) {
+        uint64_t size_inverse = ntt_power(size, NTT_PRIME - 2);
+        for (uint64_t& value : values)
+            value = ntt_multiply(value, size_inverse);
+    }
+}
+
+/*
+    multiply_ntt
+    ------------
+    Stores the product of two magnitudes in `result`, which must hold
+    `size1 + size2` zeroed limbs, as a cyclic convolution of their 16-bit
+    digits. Each convolution term is below (shorter length) * 2^32, which stays
+    under the prime for any operands that fit in memory, so one prime suffices.
+*/
+
+void multiply_ntt(
+        uint64_t* result, const uint64_t* num1, size_t size1,
+        const uint64_t* num2, size_t size2)
+{
+    size_t digits1 = 4 * size1, digits2 = 4 * size2;
+    size_t size = 1;
+    while (size < digits1 + digits2)
+        size <<= 1;
+
+    std::vector<uint64_t> values1(size, 0), values2(size, 0);
+    for (size_t i = 0; i < digits1; i++)
+        values1[i] = (num1[i / 4] >> (16 * (i % 4))) & 0xffff;
+    for (size_t i = 0; i < digits2; i++)
+        values2[i] = (num2[i / 4] >> (16 * (i % 4))) & 0xffff;
+
+    ntt_transform(values1, false);
+    ntt_transform(values2, false);
+    for (size_t i = 0; i < size; i++)
+        values1[i] = ntt_multiply(values1[i], values2[i]);
+    ntt_transform(values1, true);
+
+    // propagate the carries back into 16-bit digits
+    Double_limb carry = 0;
+    for (size_t i = 0; i < digits1 + digits2; i++) {
+        carry += values1[i];
+        result[i / 4] |= (uint64_t) (carry & 0xffff) << (16 * (i % 4));
+        carry >>= 16;
+    }
+}
+
+void multiply_limbs(
+        uint64_t* result, const uint64_t* num1, size_t size1,
+        const uint64_t* num2, size_t size2);
+
+/*
+    add_shifted
+    -----------
+    Adds the non-negative BigInt `num`, shifted left by `offset` limbs, to the
+    `size` limbs of `result`.
+*/
+
+void add_shifted(uint64_t* result, size_t size, const BigInt& num, size_t offset)
+{
+    add_limbs(result + offset, result + offset, size - offset, num.limb_data(),
+              num.limb_count());
+}
+
+/*
+    multiply_toom3
+    --------------
+    Stores the product of two magnitudes in `result`, which must hold
+    `size1 + size2` zeroed limbs, using Toom-Cook 3-way splitting: both
+    operands are cut into three pieces of `k` limbs, evaluated at 0, 1, -1, -2
+    and infinity, multiplied pointwise (through the full tier dispatch) and
+    interpolated with Bodrato's sequence.
+*/
+
+void multiply_toom3(
+        uint64_t* result, const uint64_t* num1, size_t size1,
+        const uint64_t* num2, size_t size2)
+{
+    size_t k = (std::max(size1, size2) + 2) / 3;
+    auto piece = [k](const uint64_t* num, size_t size, size_t index) {
+        size_t begin = std::min(size, index * k);
+        size_t end = std::min(size, begin + k);
+        return BigInt::from_limbs(num + begin, end - begin);
+    };
+    BigInt num1_0 = piece(num1, size1, 0), num1_1 = piece(num1, size1, 1),
+           num1_2 = piece(num1, size1, 2);
+    BigInt num2_0 = piece(num2, size2, 0), num2_1 = piece(num2, size2, 1),
+           num2_2 = piece(num2, size2, 2);
+
+    // evaluation at 1, -1 and -2
+    BigInt partial1 = num1_0 + num1_2, partial2 = num2_0 + num2_2;
+    BigInt at_one1 = partial1 + num1_1, at_one2 = partial2 + num2_1;
+    BigInt at_minus_one1 = partial1 - num1_1;
+    BigInt at_minus_one2 = partial2 - num2_1;
+    BigInt at_minus_two1 = (at_minus_one1 + num1_2) * 2 - num1_0;
+    BigInt at_minus_two2 = (at_minus_one2 + num2_2) * 2 - num2_0;
+
+    // pointwise products
+    BigInt r0 = num1_0 * num2_0;
+    BigInt r1 = at_one1 * at_one2;
+    BigInt r_minus_one = at_minus_one1 * at_minus_one2;
+    BigInt r_minus_two = at_minus_two1 * at_minus_two2;
+    BigInt r_inf = num1_2 * num2_2;
+
+    // interpolation; every division is exact
+    BigInt r3 = (r_minus_two - r1) / 3;
+    r1 = (r1 - r_minus_one) / 2;
+    BigInt r2 = r_minus_one - r0;
+    r3 = (r2 - r3) / 2 + r_inf * 2;
+    r2 += r1 - r_inf;
+    r1 -= r3;
+
+    size_t size = size1 + size2;
+    add_shifted(result, size, r0, 0);
+    add_shifted(result, size, r1, k);
+    add_shifted(result, size, r2, 2 * k);
+    add_shifted(result, size, r3, 3 * k);
+    add_shifted(result, size, r_inf, 4 * k);
+}
+
+/*
+    multiply_limbs
+    --------------
+    Stores the product of two magnitudes in `result`, which must hold
+    `size1 + size2` zeroed limbs, picking the multiplication tier from the
+    length of the shorter operand. Below the Toom-3 threshold the Karatsuba
+    temporaries for the whole multiplication tree come from a per-thread arena
+    that is sized up front and only ever grows, so a multiplication does not
+    allocate in steady state.
+*/
+
+void multiply_limbs(
+        uint64_t* result, const uint64_t* num1, size_t size1,
+        const uint64_t* num2, size_t size2)
+{
+    size_t smaller = std::min(size1, size2), larger = std::max(size1, size2);
+    if (smaller >= NTT_THRESHOLD) {
+        multiply_ntt(result, num1, size1, num2, size2);
+        return;
+    }
+    if (smaller >= TOOM3_THRESHOLD) {
+        if (2 * larger <= 3 * smaller) {
+            multiply_toom3(result, num1, size1, num2, size2);
+            return;
+        }
+
+        // unbalanced operands: multiply the longer one in pieces as long as
+        // the shorter one
+        const uint64_t* longer = size1 >= size2 ? num1 : num2;
+        const uint64_t* shorter = size1 >= size2 ? num2 : num1;
+        Limbs partial(2 * smaller);
+        for (size_t i = 0; i < larger; i += smaller) {
+            size_t piece = std::min(smaller, larger - i);
+            std::fill(partial.begin(), partial.end(), 0);
+            multiply_limbs(partial.data(), longer + i, piece, shorter, smaller);
+            add_limbs(result + i, result + i, larger + smaller - i,
+                      partial.data(), piece + smaller);
+        }
+        return;
+    }
+
+    thread_local Limbs arena;
+    size_t scratch_size = karatsuba_scratch_size(larger);
+    if (arena.size() < scratch_size)
+        arena.resize(scratch_size);
+
+    multiply_karatsuba(result, num1, size1, num2, size2, arena.data());
+}
+
+/*
+    add_magnitudes
+    --------------
+    Returns the sum of two magnitudes.
+*/
+
+Limbs add_magnitudes(const Limbs& num1, const Limbs& num2)
+{
+    const Limbs& larger = num1.size() >= num2.size() ? num1 : num2;
+    const Limbs& smaller = num1.size() >= num2.size() ? num2 : num1;
+
+    Limbs sum(larger.size() + 1);
+    sum.back() = add_limbs(sum.data(), larger.data(), larger.size(),
+                           smaller.data(), smaller.size());
+    strip_leading_zeroes(sum);
+
+    return sum;
+}
+
+/*
+    subtract_magnitudes
+    -------------------
+    Returns the difference of two magnitudes.
+    NOTE: `larger` must not be less than `smaller`.
+*/
+
+Limbs subtract_magnitudes(const Limbs& larger, const Limbs& smaller)
+{
+    Limbs difference(larger.size());
+    subtract_limbs(difference.data(), larger.data(), larger.size(),
+                   smaller.data(), smaller.size());
+    strip_leading_zeroes(difference);
+
+    return difference;
+}
+
+/*
+    multiply_magnitudes
+    -------------------
+    Returns the product of two magnitudes.
+*/
+
+Limbs multiply_magnitudes(const Limbs& num1, const Limbs& num2)
+{
+    if (num1.empty() or num2.empty())
+        return Limbs();
+
+    Limbs product;
+    if (num1.size() == 1 and num2.size() == 1) {
+        // single limbs: the product fits a native 128-bit integer
+        assign_double_limb(product, (Double_limb) num1[0] * num2[0]);
+        return product;
+    }
+
+    product.resize(num1.size() + num2.size());
+    multiply_limbs(product.data(), num1.data(), num1.size(), num2.data(),
+                   num2.size());
+    strip_leading_zeroes(product);
+
+    return product;
+}
+
+/*
+    multiply_add_limb
+    -----------------
+    Replaces the magnitude `num` with `num * multiplier + addend`.
+*/
+
+void multiply_add_limb(Limbs& num, uint64_t multiplier, uint64_t addend)
+{
+    uint64_t carry = addend;
+    for (uint64_t& limb : num) {
+        Double_limb product = (Double_limb) limb * multiplier + carry;
+        limb = (uint64_t) product;
+        carry = (uint64_t) (product >> 64);
+    }
+    if (carry)
+        num.push_back(carry);
+}
+
+/*
+    divide_by_limb
+    --------------
+    Replaces the magnitude `num` with its quotient on division by a single
+    non-zero limb and returns the remainder.
+*/
+
+uint64_t divide_by_limb(Limbs& num, uint64_t divisor)
+{
+    Double_limb remainder = 0;
+    for (size_t i = num.size(); i-- > 0;) {
+        Double_limb current = (remainder << 64) | num[i];
+        num[i] = (uint64_t) (current / divisor);
+        remainder = current % divisor;
+    }
+    strip_leading_zeroes(num);
+
+    return (uint64_t) remainder;
+}
+
+/*
+    shift_limbs_left
+    ----------------
+    Stores the first `size` limbs of `num` shifted left by `shift` bits (less
+    than 64) in `result`, and returns the bits shifted out of the top limb.
+*/
+
+uint64_t shift_limbs_left(
+        uint64_t* result, const uint64_t* num, size_t size, unsigned shift)
+{
+    if (shift == 0) {
+        std::copy(num, num + size, result);
+        return 0;
+    }
+
+    uint64_t carry = 0;
+    for (size_t i = 0; i < size; i++) {
+        uint64_t limb = num[i];
+        result[i] = (limb << shift) | carry;
+        carry = limb >> (64 - shift);
+    }
+
+    return carry;
+}
+
+/*
+    divide_magnitudes
+    -----------------
+    Computes the quotient and remainder on dividing the magnitude `dividend` by
+    the non-zero magnitude `divisor` using Knuth's Algorithm D (TAOCP vol. 2,
+    4.3.1): the divisor is normalised so that its top bit is set, after which
+    each quotient limb is estimated from the top two limbs of the running
+    remainder and is off by at most two.
+*/
+
+void divide_magnitudes(const Limbs& dividend, const Limbs& divisor,
+                       Limbs& quotient, Limbs& remainder)
+{
+    if (compare_magnitudes(dividend, divisor) < 0) {
+        quotient.clear();
+        remainder = dividend;
+        return;
+    }
+    if (dividend.size() <= 2) {
+        // both operands fit a native 128-bit integer
+        Double_limb num1 = to_double_limb(dividend);
+        Double_limb num2 = to_double_limb(divisor);
+        assign_double_limb(quotient, num1 / num2);
+        assign_double_limb(remainder, num1 % num2);
+        return;
+    }
+    if (divisor.size() == 1) {
+        quotient = dividend;
+        uint64_t limb_remainder = divide_by_limb(quotient, divisor[0]);
+        remainder.clear();
+        if (limb_remainder)
+            remainder.push_back(limb_remainder);
+        return;
+    }
+
+    size_t n = divisor.size(), m = dividend.size() - n;
+    unsigned shift = __builtin_clzll(divisor.back());
+
+    // normalise: shift both operands so the top bit of the divisor is set
+    Limbs norm_divisor(n), norm_dividend(m + n + 1);
+    shift_limbs_left(norm_divisor.data(), divisor.data(), n, shift);
+    norm_dividend[m + n] = shift_limbs_left(norm_dividend.data(),
+                                            dividend.data(), m + n, shift);
+    uint64_t divisor_top = norm_divisor[n - 1];
+    uint64_t divisor_next = norm_divisor[n - 2];
+
+    quotient.assign(m + 1, 0);
+    for (size_t j = m + 1; j-- > 0;) {
+        uint64_t* window = norm_dividend.data() + j;
+
+        // estimate the quotient limb from the top two limbs of the window
+        Double_limb numerator = ((Double_limb) window[n] << 64) | window[n - 1];
+        Double_limb q_hat = numerator / divisor_top;
+        Double_limb r_hat = numerator % divisor_top;
+        while (q_hat >> 64
+               or (!(r_hat >> 64)
+                   and q_hat * divisor_next
+                           > ((r_hat << 64) | window[n - 2]))) {
+            q_hat--;
+            r_hat += divisor_top;
+        }
 
-    return true;  // first digit is 1 and the following digits are all 0
+        // window -= q_hat * divisor
+        uint64_t carry = 0, borrow = 0;
+        for (size_t i = 0; i < n; i++) {
+            Double_limb product = q_hat * norm_divisor[i] + carry;
+            carry = (uint64_t) (product >> 64);
+            uint64_t low = (uint64_t) product;
+            uint64_t difference = window[i] - low;
+            uint64_t next_borrow = window[i] < low;
+            next_borrow |= difference < borrow;
+            window[i] = difference - borrow;
+            borrow = next_borrow;
+        }
+        Double_limb top_subtrahend = (Double_limb) carry + borrow;
+        bool negative = window[n] < top_subtrahend;
+        window[n] -= (uint64_t) top_subtrahend;
+
+        // the estimate was one too large: add the divisor back
+        if (negative) {
+            q_hat--;
+            window[n] += add_limbs(window, window, n, norm_divisor.data(), n);
+        }
+        quotient[j] = (uint64_t) q_hat;
+    }
+    strip_leading_zeroes(quotient);
+
+    // un-normalise the remainder, which is left in the low limbs
+    remainder.assign(n, 0);
+    for (size_t i = 0; i < n; i++) {
+        remainder[i] = shift == 0
+                ? norm_dividend[i]
+                : (norm_dividend[i] >> shift)
+                        | (norm_dividend[i + 1] << (64 - shift));
+    }
+    strip_leading_zeroes(remainder);
 }
 
 /*
@@ -136,18 +833,277 @@ BigInt big_random(size_t num_digits = 0)
         // use a random number for it:
         num_digits = 1 + rand_generator() % MAX_RANDOM_LENGTH;
 
-    BigInt big_rand;
-    big_rand.value = "";  // clear value to append digits
+    std::mt19937_64 generator((uint64_t) rand_generator() << 32
+                              | rand_generator());
+    return big_random(num_digits, generator);
+}
+
+/*
+    big_random (num_digits, generator)
+    ----------------------------------
+    Returns a BigInt with a specific number of digits drawn from the given
+    generator, so that the same seed gives the same sequence of numbers.
+*/
+
+BigInt big_random(size_t num_digits, std::mt19937_64& generator)
+{
+    if (num_digits == 0)
+        return 0;
+
+    std::string digits;
 
     // ensure that the first digit is non-zero
-    big_rand.value += std::to_string(1 + rand_generator() % 9);
+    digits += std::to_string(1 + generator() % 9);
 
-    while (big_rand.value.size() < num_digits)
-        big_rand.value += std::to_string(rand_generator());
-    if (big_rand.value.size() != num_digits)
-        big_rand.value.erase(num_digits);  // erase extra digits
+    while (digits.size() < num_digits) {
+        std::string chunk = std::to_string(generator() % DECIMAL_CHUNK_BASE);
+        digits.append(DECIMAL_CHUNK_DIGITS - chunk.size(), '0');
+        digits += chunk;
+    }
+    if (digits.size() != num_digits)
+        digits.erase(num_digits);  // erase extra digits
 
-    return big_rand;
+    return BigInt(digits);
+}
+
+/*
+    ===========================================================================
+    Decimal conversion functions for BigInt
+    ===========================================================================
+    Short numbers are converted one 19-digit chunk at a time, which is
+    quadratic in the length. Longer ones are split in halves at a power
+    10^(19 * 2^k) and converted recursively, so that the work is dominated by
+    a few large multiplications (parsing) or divisions (printing) and
+    inherits the subquadratic multiplication tiers.
+*/
+
+#include <deque>
+
+/*
+    parse_decimal_chunks
+    --------------------
+    Returns the magnitude of the decimal digits in [first, last), consuming
+    them in chunks that fit in a limb, the first chunk taking whatever is left
+    over.
+*/
+
+Limbs parse_decimal_chunks(const char* first, const char* last)
+{
+    Limbs result;
+    size_t size = last - first;
+    size_t chunk_size = size % DECIMAL_CHUNK_DIGITS;
+    if (chunk_size == 0)
+        chunk_size = DECIMAL_CHUNK_DIGITS;
+    for (size_t i = 0; i < size; i += chunk_size,
+                chunk_size = DECIMAL_CHUNK_DIGITS) {
+        uint64_t chunk = 0, chunk_base = 1;
+        for (size_t j = i; j < i + chunk_size; j++) {
+            chunk = chunk * 10 + (first[j] - '0');
+            chunk_base *= 10;
+        }
+        multiply_add_limb(result, chunk_base, chunk);
+    }
+    strip_leading_zeroes(result);
+
+    return result;
+}
+
+/*
+    reciprocal
+    ----------
+    Returns floor(2^(2s) / num) for a positive `num` of s bits. Newton's
+    iteration x' = x + x * (2^(2s) - num * x) / 2^(2s) doubles the number of
+    correct bits, so the reciprocal of the top half of `num` gives a start
+    that a single step refines to within a few units, which are then fixed
+    exactly.
+*/
+
+BigInt reciprocal(const BigInt& num)
+{
+    size_t bits = num.bit_length();
+    BigInt power = BigInt(1) << (2 * bits);
+    if (num.limb_count() < RECIPROCAL_THRESHOLD)
+        return power / num;
+
+    // a few guard bits keep the error of the starting point small
+    size_t half_bits = bits / 2 + 8;
+    BigInt x = reciprocal(num >> (bits - half_bits)) << (bits - half_bits);
+    x += (x * (power - num * x)) >> (2 * bits);
+
+    BigInt remainder = power - num * x;
+    while (remainder < 0) {
+        x -= 1;
+        remainder += num;
+    }
+    while (remainder >= num) {
+        x += 1;
+        remainder -= num;
+    }
+
+    return x;
+}
+
+/*
+    decimal_power
+    -------------
+    Returns 10^(19 * 2^level) together with its number of digits. The powers
+    are computed by repeated squaring once per thread and kept for later
+    conversions, as are their reciprocals once a division needs them.
+*/
+
+struct Decimal_power {
+    BigInt power;
+    BigInt reciprocal;  // zero until first needed
+    size_t digits;
+};
+
+Decimal_power& decimal_power(size_t level)
+{
+    // a deque, so that references stay valid as the table grows
+    thread_local std::deque<Decimal_power> powers;
+    while (powers.size() <= level) {
+        Decimal_power next;
+        if (powers.empty()) {
+            next.power = BigInt::from_limbs(&DECIMAL_CHUNK_BASE, 1);
+            next.digits = DECIMAL_CHUNK_DIGITS;
+        } else {
+            next.power = powers.back().power * powers.back().power;
+            next.digits = 2 * powers.back().digits;
+        }
+        powers.push_back(std::move(next));
+    }
+
+    return powers[level];
+}
+
+/*
+    parse_decimal
+    -------------
+    Returns the non-negative BigInt written with the decimal digits in
+    [first, last).
+*/
+
+BigInt parse_decimal(const char* first, const char* last)
+{
+    size_t size = last - first;
+    if (size <= PARSE_SPLIT_THRESHOLD) {
+        Limbs magnitude = parse_decimal_chunks(first, last);
+        return BigInt::from_limbs(magnitude.data(), magnitude.size());
+    }
+
+    // the low part takes the largest power that leaves a non-empty high part
+    size_t level = 0;
+    while ((DECIMAL_CHUNK_DIGITS << (level + 1)) < size)
+        level++;
+    const Decimal_power& split = decimal_power(level);
+
+    BigInt result = parse_decimal(first, last - split.digits) * split.power;
+    result += parse_decimal(last - split.digits, last);
+
+    return result;
+}
+
+/*
+    divmod_power
+    ------------
+    Returns the quotient and remainder of a non-negative BigInt below
+    split.power^2 on division by split.power.
+*/
+
+std::tuple<BigInt, BigInt> divmod_power(const BigInt& num, Decimal_power& split)
+{
+    if (split.power.limb_count() < RECIPROCAL_THRESHOLD)
+        return divmod(num, split.power);
+    if (split.reciprocal == 0)
+        split.reciprocal = reciprocal(split.power);
+
+    // Barrett's estimate is at most two below the true quotient
+    size_t bits = split.power.bit_length();
+    BigInt quotient = ((num >> (bits - 1)) * split.reciprocal) >> (bits + 1);
+    BigInt remainder = num - quotient * split.power;
+    while (remainder >= split.power) {
+        quotient += 1;
+        remainder -= split.power;
+    }
+
+    return std::make_tuple(quotient, remainder);
+}
+
+/*
+    append_decimal
+    --------------
+    Appends the decimal digits of a non-negative BigInt to `result`, padded
+    with leading zeroes to at least `min_digits` digits.
+*/
+
+void append_decimal(const BigInt& num, size_t min_digits, std::string& result)
+{
+    if (num.limb_count() <= PRINT_SPLIT_THRESHOLD) {
+        // peel off chunks of decimal digits, least significant first, and
+        // write them from the back of a buffer
+        Limbs magnitude(num.limb_count());
+        for (size_t i = 0; i < magnitude.size(); i++)
+            magnitude[i] = num.limb(i);
+        char buffer[(PRINT_SPLIT_THRESHOLD + 1) * 20];
+        char* end = buffer + sizeof(buffer);
+        char* begin = end;
+        while (!magnitude.empty()) {
+            uint64_t chunk = divide_by_limb(magnitude, DECIMAL_CHUNK_BASE);
+            for (size_t i = 0; i < DECIMAL_CHUNK_DIGITS; i++, chunk /= 10)
+                *--begin = '0' + chunk % 10;
+        }
+        while (begin != end and *begin == '0')  // padding of the top chunk
+            begin++;
+
+        if ((size_t) (end - begin) < min_digits)
+            result.append(min_digits - (end - begin), '0');
+        result.append(begin, end);
+        return;
+    }
+
+    // split at the largest power not above the number, so that the high half
+    // is non-zero and both halves are below the power. The next power has at
+    // least 2b - 1 bits for a power of b bits, which rules it out without
+    // computing it when the number is shorter than that.
+    size_t level = 0;
+    while (2 * decimal_power(level).power.bit_length() - 1 <= num.bit_length()
+           and decimal_power(level + 1).power <= num)
+        level++;
+    Decimal_power& split = decimal_power(level);
+
+    auto [high, low] = divmod_power(num, split);
+    append_decimal(high, min_digits > split.digits ? min_digits - split.digits : 0,
+                   result);
+    append_decimal(low, split.digits, result);
+}
+
+/*
+    from_chars
+    ----------
+    Parses a decimal integer with an optional leading '-' from the start of
+    [first, last) in the manner of std::from_chars: on success `value` is set
+    and the returned pointer is past the last digit; when there are no digits
+    `value` is left alone and std::errc::invalid_argument is returned. Nothing
+    is copied, so tokens can be read straight out of a larger text.
+*/
+
+std::from_chars_result from_chars(
+        const char* first, const char* last, BigInt& value)
+{
+    const char* digits = first;
+    if (digits != last and *digits == '-')
+        digits++;
+    const char* end = digits;
+    while (end != last and *end >= '0' and *end <= '9')
+        end++;
+    if (end == digits)
+        return { first, std::errc::invalid_argument };
+
+    value = parse_decimal(digits, end);
+    if (digits != first)
+        value = -value;
+
+    return { end, std::errc() };
 }
 
 /*
@@ -163,7 +1119,6 @@ BigInt big_random(size_t num_digits = 0)
 
 BigInt::BigInt()
 {
-    value = "0";
     sign = '+';
 }
 
@@ -178,6 +1133,18 @@ BigInt::BigInt(const BigInt& num)
     sign = num.sign;
 }
 
+/*
+    Move constructor
+    ----------------
+    Takes over the limbs of `num`, which is left equal to zero.
+*/
+
+BigInt::BigInt(BigInt&& num) noexcept
+    : value(std::move(num.value)), sign(num.sign)
+{
+    num.sign = '+';
+}
+
 /*
     Integer to BigInt
     -----------------
@@ -185,7 +1152,10 @@ BigInt::BigInt(const BigInt& num)
 
 BigInt::BigInt(const long long& num)
 {
-    value = std::to_string(std::abs(num));
+    // negate in unsigned arithmetic so that LLONG_MIN does not overflow
+    uint64_t magnitude = num < 0 ? 0 - (uint64_t) num : (uint64_t) num;
+    if (magnitude)
+        value.push_back(magnitude);
     if (num < 0)
         sign = '-';
     else
@@ -199,25 +1169,20 @@ BigInt::BigInt(const long long& num)
 
 BigInt::BigInt(const std::string& num)
 {
+    size_t digits_start = 0;
+    sign = '+';  // positive by default
     if (num[0] == '+' or num[0] == '-') {  // check for sign
-        std::string magnitude = num.substr(1);
-        if (is_valid_number(magnitude)) {
-            value = magnitude;
-            sign = num[0];
-        } else {
-            throw std::invalid_argument(
-                    "Expected an integer, got \'" + num + "\'");
-        }
-    } else {  // if no sign is specified
-        if (is_valid_number(num)) {
-            value = num;
-            sign = '+';  // positive by default
-        } else {
-            throw std::invalid_argument(
-                    "Expected an integer, got \'" + num + "\'");
-        }
+        sign = num[0];
+        digits_start = 1;
     }
-    strip_leading_zeroes(value);
+    if (!is_valid_number(std::string_view(num).substr(digits_start)))
+        throw std::invalid_argument("Expected an integer, got \'" + num + "\'");
+
+    value = std::move(
+            parse_decimal(num.data() + digits_start, num.data() + num.size())
+                    .value);
+    if (value.empty())  // zero is never negative
+        sign = '+';
 }
 
 /*
@@ -234,47 +1199,128 @@ BigInt::BigInt(const std::string& num)
 
 std::string BigInt::to_string() const
 {
+    if (value.empty())
+        return "0";
+
     // prefix with sign if negative
-    return this->sign == '-' ? "-" + this->value : this->value;
+    std::string result = this->sign == '-' ? "-" : "";
+    append_decimal(abs(*this), 0, result);
+
+    return result;
 }
 
 /*
     to_int
     ------
     Converts a BigInt to an int.
-    NOTE: If the BigInt is out of range of an int, stoi() will throw an
-    out_of_range exception.
+    NOTE: If the BigInt is out of range of an int, an out_of_range exception is
+    thrown.
 */
 
 int BigInt::to_int() const
 {
-    return std::stoi(this->to_string());
+    long long num = this->to_long_long();
+    if (num < INT_MIN or num > INT_MAX)
+        throw std::out_of_range("BigInt is out of range of an int");
+
+    return (int) num;
 }
 
 /*
     to_long
     -------
     Converts a BigInt to a long int.
-    NOTE: If the BigInt is out of range of a long int, stol() will throw an
-    out_of_range exception.
+    NOTE: If the BigInt is out of range of a long int, an out_of_range
+    exception is thrown.
 */
 
 long BigInt::to_long() const
 {
-    return std::stol(this->to_string());
+    long long num = this->to_long_long();
+    if (num < LONG_MIN or num > LONG_MAX)
+        throw std::out_of_range("BigInt is out of range of a long int");
+
+    return (long) num;
 }
 
 /*
     to_long_long
     ------------
     Converts a BigInt to a long long int.
-    NOTE: If the BigInt is out of range of a long long int, stoll() will throw
-    an out_of_range exception.
+    NOTE: If the BigInt is out of range of a long long int, an out_of_range
+    exception is thrown.
 */
 
 long long BigInt::to_long_long() const
 {
-    return std::stoll(this->to_string());
+    if (value.empty())
+        return 0;
+
+    uint64_t magnitude = value[0];
+    uint64_t limit = (uint64_t) LLONG_MAX + (sign == '-' ? 1 : 0);
+    if (value.size() > 1 or magnitude > limit)
+        throw std::out_of_range("BigInt is out of range of a long long int");
+
+    return sign == '-' ? (long long) (0 - magnitude) : (long long) magnitude;
+}
+
+/*
+    ===========================================================================
+    Limb access functions for BigInt
+    ===========================================================================
+    The magnitude is exposed as little-endian 64-bit limbs so that modular
+    arithmetic can work on the raw words without going through the operators.
+*/
+
+/*
+    limb_count
+    ----------
+    Returns the number of limbs in the magnitude of a BigInt (0 for zero).
+*/
+
+size_t BigInt::limb_count() const
+{
+    return value.size();
+}
+
+/*
+    limb
+    ----
+    Returns the limb of the magnitude at `index`, least significant first, or 0
+    when `index` is past the most significant limb.
+*/
+
+uint64_t BigInt::limb(size_t index) const
+{
+    return index < value.size() ? value[index] : 0;
+}
+
+/*
+    limb_data
+    ---------
+    Returns the `limb_count()` limbs of the magnitude, least significant
+    first, for passing to the limb routines without a copy.
+*/
+
+const uint64_t* BigInt::limb_data() const
+{
+    return value.data();
+}
+
+/*
+    from_limbs
+    ----------
+    Returns the non-negative BigInt whose magnitude is given by `count`
+    little-endian limbs.
+*/
+
+BigInt BigInt::from_limbs(const uint64_t* limbs, size_t count)
+{
+    BigInt num;
+    num.value.assign(limbs, limbs + count);
+    strip_leading_zeroes(num.value);
+
+    return num;
 }
 
 /*
@@ -296,6 +1342,20 @@ BigInt& BigInt::operator=(const BigInt& num)
     return *this;
 }
 
+/*
+    BigInt = BigInt (move)
+    ----------------------
+*/
+
+BigInt& BigInt::operator=(BigInt&& num) noexcept
+{
+    value = std::move(num.value);
+    sign = num.sign;
+    num.sign = '+';
+
+    return *this;
+}
+
 /*
     BigInt = Integer
     ----------------
@@ -354,7 +1414,7 @@ BigInt BigInt::operator-() const
     BigInt temp;
 
     temp.value = value;
-    if (value != "0") {
+    if (!value.empty()) {
         if (sign == '+')
             temp.sign = '-';
         else
@@ -378,7 +1438,7 @@ BigInt BigInt::operator-() const
 
 bool BigInt::operator==(const BigInt& num) const
 {
-    return (sign == num.sign) and (value == num.value);
+    return (sign == num.sign) and compare_magnitudes(value, num.value) == 0;
 }
 
 /*
@@ -399,13 +1459,8 @@ bool BigInt::operator!=(const BigInt& num) const
 bool BigInt::operator<(const BigInt& num) const
 {
     if (sign == num.sign) {
-        if (sign == '+') {
-            if (value.length() == num.value.length())
-                return value < num.value;
-            else
-                return value.length() < num.value.length();
-        } else
-            return -(*this) > -num;
+        int comparison = compare_magnitudes(value, num.value);
+        return sign == '+' ? comparison < 0 : comparison > 0;
     } else
         return sign == '-';
 }
@@ -706,7 +1761,17 @@ BigInt abs(const BigInt& num)
 
 BigInt big_pow10(size_t exp)
 {
-    return BigInt("1" + std::string(exp, '0'));
+    // square-and-multiply, so that large powers use the fast multipliers
+    BigInt result = 1, base = 10;
+    while (exp) {
+        if (exp & 1)
+            result *= base;
+        exp >>= 1;
+        if (exp)
+            base *= base;
+    }
+
+    return result;
 }
 
 /*
@@ -756,76 +1821,144 @@ BigInt pow(const long long& base, int exp)
     Returns a BigInt equal to base^exp.
 */
 
-BigInt pow(const std::string& base, int exp)
-{
-    return pow(BigInt(base), exp);
+BigInt pow(const std::string& base, int exp)
+{
+    return pow(BigInt(base), exp);
+}
+
+/*
+    isqrt
+    -----
+    Returns floor(sqrt(num)) for a non-negative BigInt. The square root of the
+    number with its low 2k bits dropped, for k about a quarter of its length,
+    is computed recursively and scaled up by 2^k, giving a starting point just
+    above the root with half of its bits correct. Newton's iteration
+    x' = (x + num / x) / 2 then decreases monotonically to the root, and
+    doubles the number of correct bits each time, so it takes one or two
+    steps at each level. Numbers of up to 128 bits are handled natively.
+*/
+
+BigInt isqrt(const BigInt& num)
+{
+    if (num < 0)
+        throw std::invalid_argument(
+                "Cannot compute square root of a negative integer");
+
+    if (num.limb_count() <= 2) {
+        Double_limb value = ((Double_limb) num.limb(1) << 64) | num.limb(0);
+        if (value == 0)
+            return 0;
+
+        // a floating-point estimate, which one Newton step brings to within
+        // one of the root from above
+        Double_limb root = (Double_limb) std::sqrt((long double) value);
+        if (root == 0)
+            root = 1;
+        root = (root + value / root) / 2;
+        while (true) {
+            Double_limb next = (root + value / root) / 2;
+            if (next >= root)
+                break;
+            root = next;
+        }
+
+        uint64_t limbs[1] = { (uint64_t) root };
+        return BigInt::from_limbs(limbs, 1);
+    }
+
+    size_t shift = num.bit_length() / 4;
+    BigInt root = (isqrt(num >> (2 * shift)) + 1) << shift;
+    while (true) {
+        BigInt next = (root + num / root) >> 1;
+        if (next >= root)
+            break;
+        root = std::move(next);
+    }
+
+    return root;
 }
 
 /*
     sqrt
     ----
-    Returns the positive integer square root of a BigInt using Newton's method.
+    Returns the positive integer square root of a BigInt, rounded down.
     NOTE: the input must be non-negative.
 */
 
 BigInt sqrt(const BigInt& num)
 {
-    if (num < 0)
-        throw std::invalid_argument(
-                "Cannot compute square root of a negative integer");
-
-    // Optimisations for small inputs:
-    if (num == 0)
-        return 0;
-    else if (num < 4)
-        return 1;
-    else if (num < 9)
-        return 2;
-    else if (num < 16)
-        return 3;
-
-    BigInt sqrt_prev = -1;
-    // The value for `sqrt_current` is chosen close to that of the actual
-    // square root.
-    // Since a number's square root has at least one less than half as many
-    // digits as the number,
-    //     sqrt_current = 10^(half_the_digits_in_num - 1)
-    BigInt sqrt_current = big_pow10(num.to_string().size() / 2 - 1);
-
-    while (abs(sqrt_current - sqrt_prev) > 1) {
-        sqrt_prev = sqrt_current;
-        sqrt_current = (num / sqrt_prev + sqrt_prev) / 2;
-    }
-
-    return sqrt_current;
+    return isqrt(num);
 }
 
 /*
     gcd(BigInt, BigInt)
     -------------------
     Returns the greatest common divisor (GCD, a.k.a. HCF) of two BigInts using
-    Euclid's algorithm.
+    Lehmer's algorithm (TAOCP vol. 2, 4.5.2, algorithm L): Euclid's algorithm
+    is simulated on the leading 62 bits of both numbers for as long as the
+    quotients are certain, and the combined steps are then applied to the
+    full numbers with a few single-limb multiplications. Once both fit in 128
+    bits, the rest is done natively with the binary GCD.
 */
 
 BigInt gcd(const BigInt& num1, const BigInt& num2)
 {
-    BigInt abs_num1 = abs(num1);
-    BigInt abs_num2 = abs(num2);
-
-    // base cases:
-    if (abs_num2 == 0)
-        return abs_num1;  // gcd(a, 0) = |a|
-    if (abs_num1 == 0)
-        return abs_num2;  // gcd(0, a) = |a|
+    BigInt u = abs(num1);
+    BigInt v = abs(num2);
+    if (u < v)
+        std::swap(u, v);
+
+    // the 64 bits of a non-negative BigInt starting at bit `shift`
+    auto bits_at = [](const BigInt& num, size_t shift) {
+        uint64_t low = num.limb(shift / 64) >> (shift % 64);
+        if (shift % 64 == 0)
+            return low;
+        return low | (num.limb(shift / 64 + 1) << (64 - shift % 64));
+    };
+
+    while (u.limb_count() > 2) {
+        if (v == 0)
+            return u;  // gcd(a, 0) = |a|
+
+        size_t shift = u.bit_length() - 62;
+        __int128 u_hat = bits_at(u, shift), v_hat = bits_at(v, shift);
+        long long a = 1, b = 0, c = 0, d = 1;
+
+        // a quotient is only taken when both bounds on the true leading
+        // digits agree on it
+        while (v_hat + c != 0 and v_hat + d != 0) {
+            __int128 q = (u_hat + a) / (v_hat + c);
+            if (q != (u_hat + b) / (v_hat + d))
+                break;
+            long long t = a - (long long) q * c;
+            a = c;
+            c = t;
+            t = b - (long long) q * d;
+            b = d;
+            d = t;
+            __int128 w = u_hat - q * v_hat;
+            u_hat = v_hat;
+            v_hat = w;
+        }
 
-    BigInt remainder = abs_num2;
-    while (remainder != 0) {
-        remainder = abs_num1 % abs_num2;
-        abs_num1 = abs_num2;  // previous remainder
-        abs_num2 = remainder;  // current remainder
+        if (b == 0) {
+            // no certain quotient: take a full-precision Euclidean step
+            BigInt remainder = u % v;
+            u = std::move(v);
+            v = std::move(remainder);
+        } else {
+            BigInt next_u = u * a + v * b;
+            v = u * c + v * d;
+            u = std::move(next_u);
+        }
     }
 
-    return abs_num1;
+    Double_limb gcd = gcd_double_limb(
+            ((Double_limb) u.limb(1) << 64) | u.limb(0),
+            ((Double_limb) v.limb(1) << 64) | v.limb(0));
+    uint64_t limbs[2] = { (uint64_t) gcd, (uint64_t) (gcd >> 64) };
+
+    return BigInt::from_limbs(limbs, 2);
 }
 
 /*
@@ -928,10 +2061,45 @@ BigInt lcm(const std::string& num1, const BigInt& num2)
     ===========================================================================
 */
 
-#include <climits>
-#include <cmath>
+/*
+    add_in_place
+    ------------
+    Adds a magnitude with the given sign to a BigInt, reusing its limbs.
+*/
+
+void BigInt::add_in_place(const Limbs& num, char num_sign)
+{
+    if (num.empty())
+        return;
 
-const long long FLOOR_SQRT_LLONG_MAX = 3037000499;
+    if (this->sign == num_sign) {
+        // `num` may be this->value itself, so take its size before resizing
+        size_t num_size = num.size();
+        if (value.size() < num_size)
+            value.resize(num_size);
+        uint64_t carry = add_limbs(value.data(), value.data(), value.size(),
+                                   num.data(), num_size);
+        if (carry)
+            value.push_back(carry);
+    } else {
+        // subtract the smaller magnitude from the larger one and keep the sign
+        // of the larger
+        int comparison = compare_magnitudes(value, num);
+        if (comparison >= 0) {
+            subtract_limbs(value.data(), value.data(), value.size(),
+                           num.data(), num.size());
+        } else {
+            size_t own_size = value.size();
+            value.resize(num.size());
+            subtract_limbs(value.data(), num.data(), num.size(),
+                           value.data(), own_size);
+            this->sign = num_sign;
+        }
+        strip_leading_zeroes(value);
+        if (value.empty())
+            this->sign = '+';
+    }
+}
 
 /*
     BigInt + BigInt
@@ -941,36 +2109,8 @@ const long long FLOOR_SQRT_LLONG_MAX = 3037000499;
 
 BigInt BigInt::operator+(const BigInt& num) const
 {
-    // if the operands are of opposite signs, perform subtraction
-    if (this->sign == '+' and num.sign == '-') {
-        BigInt rhs = num;
-        rhs.sign = '+';
-        return *this - rhs;
-    } else if (this->sign == '-' and num.sign == '+') {
-        BigInt lhs = *this;
-        lhs.sign = '+';
-        return -(lhs - num);
-    }
-
-    // identify the numbers as `larger` and `smaller`
-    std::string larger, smaller;
-    std::tie(larger, smaller) = get_larger_and_smaller(this->value, num.value);
-
-    BigInt result;  // the resultant sum
-    result.value = "";  // the value is cleared as the digits will be appended
-    short carry = 0, sum;
-    // add the two values
-    for (long i = larger.size() - 1; i >= 0; i--) {
-        sum = larger[i] - '0' + smaller[i] - '0' + carry;
-        result.value = std::to_string(sum % 10) + result.value;
-        carry = sum / (short) 10;
-    }
-    if (carry)
-        result.value = std::to_string(carry) + result.value;
-
-    // if the operands are negative, the result is negative
-    if (this->sign == '-' and result.value != "0")
-        result.sign = '-';
+    BigInt result = *this;  // the resultant sum
+    result += num;
 
     return result;
 }
@@ -983,63 +2123,8 @@ BigInt BigInt::operator+(const BigInt& num) const
 
 BigInt BigInt::operator-(const BigInt& num) const
 {
-    // if the operands are of opposite signs, perform addition
-    if (this->sign == '+' and num.sign == '-') {
-        BigInt rhs = num;
-        rhs.sign = '+';
-        return *this + rhs;
-    } else if (this->sign == '-' and num.sign == '+') {
-        BigInt lhs = *this;
-        lhs.sign = '+';
-        return -(lhs + num);
-    }
-
-    BigInt result;  // the resultant difference
-    // identify the numbers as `larger` and `smaller`
-    std::string larger, smaller;
-    if (abs(*this) > abs(num)) {
-        larger = this->value;
-        smaller = num.value;
-
-        if (this->sign == '-')  // -larger - -smaller = -result
-            result.sign = '-';
-    } else {
-        larger = num.value;
-        smaller = this->value;
-
-        if (num.sign == '+')  // smaller - larger = -result
-            result.sign = '-';
-    }
-    // pad the smaller number with zeroes
-    add_leading_zeroes(smaller, larger.size() - smaller.size());
-
-    result.value = "";  // the value is cleared as the digits will be appended
-    short difference;
-    long i, j;
-    // subtract the two values
-    for (i = larger.size() - 1; i >= 0; i--) {
-        difference = larger[i] - smaller[i];
-        if (difference < 0) {
-            for (j = i - 1; j >= 0; j--) {
-                if (larger[j] != '0') {
-                    larger[j]--;  // borrow from the j-th digit
-                    break;
-                }
-            }
-            j++;
-            while (j != i) {
-                larger[j] = '9';  // add the borrow and take away 1
-                j++;
-            }
-            difference += 10;  // add the borrow
-        }
-        result.value = std::to_string(difference) + result.value;
-    }
-    strip_leading_zeroes(result.value);
-
-    // if the result is 0, set its sign as +
-    if (result.value == "0")
-        result.sign = '+';
+    BigInt result = *this;  // the resultant difference
+    result -= num;
 
     return result;
 }
@@ -1047,98 +2132,42 @@ BigInt BigInt::operator-(const BigInt& num) const
 /*
     BigInt * BigInt
     ---------------
-    Computes the product of two BigInts using Karatsuba's algorithm.
+    Computes the product of two BigInts, picking the algorithm from the
+    length in limbs of the shorter operand: schoolbook multiplication, then
+    Karatsuba's algorithm, Toom-Cook 3-way and a number-theoretic transform.
     The operand on the RHS of the product is `num`.
 */
 
 BigInt BigInt::operator*(const BigInt& num) const
 {
-    if (*this == 0 or num == 0)
-        return BigInt(0);
-    if (*this == 1)
-        return num;
-    if (num == 1)
-        return *this;
-
     BigInt product;
-    if (abs(*this) <= FLOOR_SQRT_LLONG_MAX and abs(num) <= FLOOR_SQRT_LLONG_MAX)
-        product = std::stoll(this->value) * std::stoll(num.value);
-    else if (is_power_of_10(this->value)) {  // if LHS is a power of 10 do
-                                             // optimised operation
-        product.value = num.value;
-        product.value.append(this->value.begin() + 1, this->value.end());
-    } else if (is_power_of_10(num.value)) {  // if RHS is a power of 10 do
-                                             // optimised operation
-        product.value = this->value;
-        product.value.append(num.value.begin() + 1, num.value.end());
-    } else {
-        // identify the numbers as `larger` and `smaller`
-        std::string larger, smaller;
-        std::tie(larger, smaller)
-                = get_larger_and_smaller(this->value, num.value);
-
-        size_t half_length = larger.size() / 2;
-        auto half_length_ceil = (size_t) ceil(larger.size() / 2.0);
-
-        BigInt num1_high, num1_low;
-        num1_high = larger.substr(0, half_length);
-        num1_low = larger.substr(half_length);
-
-        BigInt num2_high, num2_low;
-        num2_high = smaller.substr(0, half_length);
-        num2_low = smaller.substr(half_length);
-
-        strip_leading_zeroes(num1_high.value);
-        strip_leading_zeroes(num1_low.value);
-        strip_leading_zeroes(num2_high.value);
-        strip_leading_zeroes(num2_low.value);
-
-        BigInt prod_high, prod_mid, prod_low;
-        prod_high = num1_high * num2_high;
-        prod_low = num1_low * num2_low;
-        prod_mid = (num1_high + num1_low) * (num2_high + num2_low) - prod_high
-                - prod_low;
-
-        add_trailing_zeroes(prod_high.value, 2 * half_length_ceil);
-        add_trailing_zeroes(prod_mid.value, half_length_ceil);
-
-        strip_leading_zeroes(prod_high.value);
-        strip_leading_zeroes(prod_mid.value);
-        strip_leading_zeroes(prod_low.value);
-
-        product = prod_high + prod_mid + prod_low;
-    }
-    strip_leading_zeroes(product.value);
-
-    if (this->sign == num.sign)
-        product.sign = '+';
-    else
+    product.value = multiply_magnitudes(this->value, num.value);
+    if (!product.value.empty() and this->sign != num.sign)
         product.sign = '-';
 
     return product;
 }
 
 /*
-    divide
+    divmod
     ------
-    Helper function that returns the quotient and remainder on dividing the
-    dividend by the divisor, when the divisor is 1 to 10 times the dividend.
+    Returns the quotient and the remainder on dividing `dividend` by `divisor`
+    with a single long division. The quotient is truncated towards zero and the
+    remainder has the same sign as the dividend, as with `/` and `%`.
 */
 
-std::tuple<BigInt, BigInt> divide(const BigInt& dividend, const BigInt& divisor)
+std::tuple<BigInt, BigInt> divmod(const BigInt& dividend, const BigInt& divisor)
 {
-    BigInt quotient, remainder, temp;
+    if (divisor.value.empty())
+        throw std::logic_error("Attempted division by zero");
 
-    temp = divisor;
-    quotient = 1;
-    while (temp < dividend) {
-        quotient++;
-        temp += divisor;
-    }
-    if (temp > dividend) {
-        quotient--;
-        remainder = dividend - (temp - divisor);
-    }
+    BigInt quotient, remainder;
+    divide_magnitudes(dividend.value, divisor.value, quotient.value,
+                      remainder.value);
+    if (!quotient.value.empty() and dividend.sign != divisor.sign)
+        quotient.sign = '-';
+    if (!remainder.value.empty())
+        remainder.sign = dividend.sign;
 
     return std::make_tuple(quotient, remainder);
 }
@@ -1146,71 +2175,19 @@ std::tuple<BigInt, BigInt> divide(const BigInt& dividend, const BigInt& divisor)
 /*
     BigInt / BigInt
     ---------------
-    Computes the quotient of two BigInts using the long-division method.
+    Computes the quotient of two BigInts using Knuth's long-division method.
     The operand on the RHS of the division (the divisor) is `num`.
 */
 
 BigInt BigInt::operator/(const BigInt& num) const
 {
-    BigInt abs_dividend = abs(*this);
-    BigInt abs_divisor = abs(num);
-
-    if (num == 0)
+    if (num.value.empty())
         throw std::logic_error("Attempted division by zero");
-    if (abs_dividend < abs_divisor)
-        return BigInt(0);
-    if (num == 1)
-        return *this;
-    if (num == -1)
-        return -(*this);
 
     BigInt quotient;
-    if (abs_dividend <= LLONG_MAX and abs_divisor <= LLONG_MAX)
-        quotient = std::stoll(abs_dividend.value)
-                / std::stoll(abs_divisor.value);
-    else if (abs_dividend == abs_divisor)
-        quotient = 1;
-    else if (is_power_of_10(
-                     abs_divisor.value)) {  // if divisor is a power of 10 do
-                                            // optimised calculation
-        size_t digits_in_quotient
-                = abs_dividend.value.size() - abs_divisor.value.size() + 1;
-        quotient.value = abs_dividend.value.substr(0, digits_in_quotient);
-    } else {
-        quotient.value = "";  // the value is cleared as digits will be appended
-        BigInt chunk, chunk_quotient, chunk_remainder;
-        size_t chunk_index = 0;
-        chunk_remainder.value = abs_dividend.value.substr(
-                chunk_index, abs_divisor.value.size() - 1);
-        chunk_index = abs_divisor.value.size() - 1;
-        while (chunk_index < abs_dividend.value.size()) {
-            chunk.value = chunk_remainder.value.append(
-                    1, abs_dividend.value[chunk_index]);
-            chunk_index++;
-            while (chunk < abs_divisor) {
-                quotient.value += "0";
-                if (chunk_index < abs_dividend.value.size()) {
-                    chunk.value.append(1, abs_dividend.value[chunk_index]);
-                    chunk_index++;
-                } else
-                    break;
-            }
-            if (chunk == abs_divisor) {
-                quotient.value += "1";
-                chunk_remainder = 0;
-            } else if (chunk > abs_divisor) {
-                strip_leading_zeroes(chunk.value);
-                std::tie(chunk_quotient, chunk_remainder)
-                        = divide(chunk, abs_divisor);
-                quotient.value += chunk_quotient.value;
-            }
-        }
-    }
-    strip_leading_zeroes(quotient.value);
-
-    if (this->sign == num.sign)
-        quotient.sign = '+';
-    else
+    Limbs remainder;
+    divide_magnitudes(this->value, num.value, quotient.value, remainder);
+    if (!quotient.value.empty() and this->sign != num.sign)
         quotient.sign = '-';
 
     return quotient;
@@ -1225,35 +2202,16 @@ BigInt BigInt::operator/(const BigInt& num) const
 
 BigInt BigInt::operator%(const BigInt& num) const
 {
-    BigInt abs_dividend = abs(*this);
-    BigInt abs_divisor = abs(num);
-
-    if (abs_divisor == 0)
+    if (num.value.empty())
         throw std::logic_error("Attempted division by zero");
-    if (abs_divisor == 1 or abs_divisor == abs_dividend)
-        return BigInt(0);
 
     BigInt remainder;
-    if (abs_dividend <= LLONG_MAX and abs_divisor <= LLONG_MAX)
-        remainder = std::stoll(abs_dividend.value)
-                % std::stoll(abs_divisor.value);
-    else if (abs_dividend < abs_divisor)
-        remainder = abs_dividend;
-    else if (is_power_of_10(num.value)) {  // if num is a power of 10 use
-                                           // optimised calculation
-        size_t no_of_zeroes = num.value.size() - 1;
-        remainder.value = abs_dividend.value.substr(
-                abs_dividend.value.size() - no_of_zeroes);
-    } else {
-        BigInt quotient = abs_dividend / abs_divisor;
-        remainder = abs_dividend - quotient * abs_divisor;
-    }
-    strip_leading_zeroes(remainder.value);
+    Limbs quotient;
+    divide_magnitudes(this->value, num.value, quotient, remainder.value);
 
-    // remainder has the same sign as that of the dividend
-    remainder.sign = this->sign;
-    if (remainder.value == "0")  // except if its zero
-        remainder.sign = '+';
+    // remainder has the same sign as that of the dividend, except if its zero
+    if (!remainder.value.empty())
+        remainder.sign = this->sign;
 
     return remainder;
 }
@@ -1471,7 +2429,7 @@ BigInt operator%(const std::string& lhs, const BigInt& rhs)
 
 BigInt& BigInt::operator+=(const BigInt& num)
 {
-    *this = *this + num;
+    add_in_place(num.value, num.sign);
 
     return *this;
 }
@@ -1483,7 +2441,7 @@ BigInt& BigInt::operator+=(const BigInt& num)
 
 BigInt& BigInt::operator-=(const BigInt& num)
 {
-    *this = *this - num;
+    add_in_place(num.value, num.sign == '+' ? '-' : '+');
 
     return *this;
 }
@@ -1495,7 +2453,29 @@ BigInt& BigInt::operator-=(const BigInt& num)
 
 BigInt& BigInt::operator*=(const BigInt& num)
 {
-    *this = *this * num;
+    if (value.empty() or num.value.empty()) {
+        *this = BigInt();
+        return *this;
+    }
+
+    if (this->sign != num.sign)
+        this->sign = '-';
+    else
+        this->sign = '+';
+
+    if (num.value.size() == 1 and &num != this) {
+        // a single-limb multiplier is applied to the limbs in place
+        multiply_add_limb(value, num.value[0], 0);
+    } else {
+        // the product is formed in a per-thread buffer, which then swaps with
+        // the old limbs so that the next call reuses them
+        thread_local Limbs product;
+        product.assign(value.size() + num.value.size(), 0);
+        multiply_limbs(product.data(), value.data(), value.size(),
+                       num.value.data(), num.value.size());
+        strip_leading_zeroes(product);
+        std::swap(value, product);
+    }
 
     return *this;
 }
@@ -1507,7 +2487,16 @@ BigInt& BigInt::operator*=(const BigInt& num)
 
 BigInt& BigInt::operator/=(const BigInt& num)
 {
-    *this = *this / num;
+    if (num.value.empty())
+        throw std::logic_error("Attempted division by zero");
+
+    thread_local Limbs quotient, remainder;
+    divide_magnitudes(value, num.value, quotient, remainder);
+    std::swap(value, quotient);
+    if (value.empty() or this->sign == num.sign)
+        this->sign = '+';
+    else
+        this->sign = '-';
 
     return *this;
 }
@@ -1519,7 +2508,15 @@ BigInt& BigInt::operator/=(const BigInt& num)
 
 BigInt& BigInt::operator%=(const BigInt& num)
 {
-    *this = *this % num;
+    if (num.value.empty())
+        throw std::logic_error("Attempted division by zero");
+
+    // remainder keeps the sign of the dividend, except if its zero
+    thread_local Limbs quotient, remainder;
+    divide_magnitudes(value, num.value, quotient, remainder);
+    std::swap(value, remainder);
+    if (value.empty())
+        this->sign = '+';
 
     return *this;
 }
@@ -1531,7 +2528,7 @@ BigInt& BigInt::operator%=(const BigInt& num)
 
 BigInt& BigInt::operator+=(const long long& num)
 {
-    *this = *this + BigInt(num);
+    *this += BigInt(num);
 
     return *this;
 }
@@ -1543,7 +2540,7 @@ BigInt& BigInt::operator+=(const long long& num)
 
 BigInt& BigInt::operator-=(const long long& num)
 {
-    *this = *this - BigInt(num);
+    *this -= BigInt(num);
 
     return *this;
 }
@@ -1555,7 +2552,7 @@ BigInt& BigInt::operator-=(const long long& num)
 
 BigInt& BigInt::operator*=(const long long& num)
 {
-    *this = *this * BigInt(num);
+    *this *= BigInt(num);
 
     return *this;
 }
@@ -1567,7 +2564,7 @@ BigInt& BigInt::operator*=(const long long& num)
 
 BigInt& BigInt::operator/=(const long long& num)
 {
-    *this = *this / BigInt(num);
+    *this /= BigInt(num);
 
     return *this;
 }
@@ -1579,7 +2576,7 @@ BigInt& BigInt::operator/=(const long long& num)
 
 BigInt& BigInt::operator%=(const long long& num)
 {
-    *this = *this % BigInt(num);
+    *this %= BigInt(num);
 
     return *this;
 }
@@ -1591,7 +2588,7 @@ BigInt& BigInt::operator%=(const long long& num)
 
 BigInt& BigInt::operator+=(const std::string& num)
 {
-    *this = *this + BigInt(num);
+    *this += BigInt(num);
 
     return *this;
 }
@@ -1603,7 +2600,7 @@ BigInt& BigInt::operator+=(const std::string& num)
 
 BigInt& BigInt::operator-=(const std::string& num)
 {
-    *this = *this - BigInt(num);
+    *this -= BigInt(num);
 
     return *this;
 }
@@ -1615,7 +2612,7 @@ BigInt& BigInt::operator-=(const std::string& num)
 
 BigInt& BigInt::operator*=(const std::string& num)
 {
-    *this = *this * BigInt(num);
+    *this *= BigInt(num);
 
     return *this;
 }
@@ -1627,7 +2624,7 @@ BigInt& BigInt::operator*=(const std::string& num)
 
 BigInt& BigInt::operator/=(const std::string& num)
 {
-    *this = *this / BigInt(num);
+    *this /= BigInt(num);
 
     return *this;
 }
@@ -1639,7 +2636,7 @@ BigInt& BigInt::operator/=(const std::string& num)
 
 BigInt& BigInt::operator%=(const std::string& num)
 {
-    *this = *this % BigInt(num);
+    *this %= BigInt(num);
 
     return *this;
 }
@@ -1704,6 +2701,325 @@ BigInt BigInt::operator--(int)
     return temp;
 }
 
+/*
+    ===========================================================================
+    Bitwise operators
+    ===========================================================================
+    Shifts act on the magnitude, with `>>` rounding towards negative infinity
+    like an arithmetic shift. `&`, `|` and `^` treat negative numbers as
+    infinitely sign-extended two's complement, so that all operators agree
+    with the usual machine-integer identities (e.g. -1 & x == x).
+*/
+
+/*
+    to_twos_complement
+    ------------------
+    Stores the two's complement form of the number with magnitude `num` and
+    sign `sign`, sign-extended to `size` limbs, in `result`.
+*/
+
+void to_twos_complement(const Limbs& num, char sign, size_t size, Limbs& result)
+{
+    result.assign(size, 0);
+    std::copy(num.begin(), num.end(), result.begin());
+    if (sign == '-') {
+        uint64_t carry = 1;
+        for (size_t i = 0; i < size; i++) {
+            result[i] = ~result[i] + carry;
+            carry &= result[i] == 0;
+        }
+    }
+}
+
+/*
+    from_twos_complement
+    --------------------
+    Converts `num`, a two's complement number whose top bit is its sign, to a
+    magnitude in place and returns its sign.
+*/
+
+char from_twos_complement(Limbs& num)
+{
+    char sign = '+';
+    if (!num.empty() and num.back() >> 63) {
+        sign = '-';
+        uint64_t carry = 1;
+        for (size_t i = 0; i < num.size(); i++) {
+            num[i] = ~num[i] + carry;
+            carry &= num[i] == 0;
+        }
+    }
+    strip_leading_zeroes(num);
+
+    return sign;
+}
+
+/*
+    bitwise_operation
+    -----------------
+    Applies the limb-wise `op` to two BigInts given as magnitude and sign.
+    Both operands are widened by one limb so that their sign bits take part.
+*/
+
+template<typename Op>
+void bitwise_operation(const Limbs& num1, char sign1, const Limbs& num2,
+                       char sign2, Op op, Limbs& result, char& result_sign)
+{
+    size_t size = std::max(num1.size(), num2.size()) + 1;
+    Limbs twos1, twos2;
+    to_twos_complement(num1, sign1, size, twos1);
+    to_twos_complement(num2, sign2, size, twos2);
+
+    result.resize(size);
+    for (size_t i = 0; i < size; i++)
+        result[i] = op(twos1[i], twos2[i]);
+    result_sign = from_twos_complement(result);
+}
+
+/*
+    BigInt << size_t
+    ----------------
+    Returns the BigInt multiplied by 2^shift.
+*/
+
+BigInt BigInt::operator<<(size_t shift) const
+{
+    BigInt result = *this;
+    result <<= shift;
+
+    return result;
+}
+
+/*
+    BigInt >> size_t
+    ----------------
+    Returns floor(BigInt / 2^shift).
+*/
+
+BigInt BigInt::operator>>(size_t shift) const
+{
+    BigInt result = *this;
+    result >>= shift;
+
+    return result;
+}
+
+/*
+    BigInt & BigInt
+    ---------------
+*/
+
+BigInt BigInt::operator&(const BigInt& num) const
+{
+    BigInt result = *this;
+    result &= num;
+
+    return result;
+}
+
+/*
+    BigInt | BigInt
+    ---------------
+*/
+
+BigInt BigInt::operator|(const BigInt& num) const
+{
+    BigInt result = *this;
+    result |= num;
+
+    return result;
+}
+
+/*
+    BigInt ^ BigInt
+    ---------------
+*/
+
+BigInt BigInt::operator^(const BigInt& num) const
+{
+    BigInt result = *this;
+    result ^= num;
+
+    return result;
+}
+
+/*
+    BigInt <<= size_t
+    -----------------
+*/
+
+BigInt& BigInt::operator<<=(size_t shift)
+{
+    if (value.empty())
+        return *this;
+
+    size_t limb_shift = shift / 64, size = value.size();
+    unsigned bit_shift = shift % 64;
+    value.resize(size + limb_shift + 1);
+
+    // limbs move up, so walking from the top down never overwrites a limb
+    // that is still to be read
+    for (size_t i = size; i-- > 0;) {
+        uint64_t limb = value[i];
+        if (bit_shift != 0)
+            value[i + limb_shift + 1] |= limb >> (64 - bit_shift);
+        value[i + limb_shift] = limb << bit_shift;
+    }
+    std::fill(value.begin(), value.begin() + limb_shift, 0);
+    strip_leading_zeroes(value);
+
+    return *this;
+}
+
+/*
+    BigInt >>= size_t
+    -----------------
+*/
+
+BigInt& BigInt::operator>>=(size_t shift)
+{
+    size_t limb_shift = shift / 64;
+    unsigned bit_shift = shift % 64;
+    if (limb_shift >= value.size()) {
+        // everything is shifted out: 0 for non-negative, -1 for negative
+        *this = sign == '-' ? -1 : 0;
+        return *this;
+    }
+
+    // a negative number rounds down iff any 1 bit is shifted out
+    bool round_down = false;
+    if (sign == '-') {
+        for (size_t i = 0; i < limb_shift and !round_down; i++)
+            round_down = value[i] != 0;
+        if (bit_shift != 0)
+            round_down |= (value[limb_shift] << (64 - bit_shift)) != 0;
+    }
+
+    size_t size = value.size() - limb_shift;
+    for (size_t i = 0; i < size; i++) {
+        uint64_t high = i + 1 < size ? value[i + limb_shift + 1] : 0;
+        value[i] = bit_shift == 0
+                ? value[i + limb_shift]
+                : (value[i + limb_shift] >> bit_shift)
+                        | (high << (64 - bit_shift));
+    }
+    value.resize(size);
+    strip_leading_zeroes(value);
+
+    if (round_down)
+        *this -= 1;
+    else if (value.empty())
+        sign = '+';
+
+    return *this;
+}
+
+/*
+    BigInt &= BigInt
+    ----------------
+*/
+
+BigInt& BigInt::operator&=(const BigInt& num)
+{
+    if (sign == '+' and num.sign == '+') {
+        // no sign bits involved: the result is no longer than either operand
+        value.resize(std::min(value.size(), num.value.size()));
+        for (size_t i = 0; i < value.size(); i++)
+            value[i] &= num.value[i];
+        strip_leading_zeroes(value);
+        return *this;
+    }
+
+    bitwise_operation(value, sign, num.value, num.sign,
+                      [](uint64_t a, uint64_t b) { return a & b; }, value, sign);
+    return *this;
+}
+
+/*
+    BigInt |= BigInt
+    ----------------
+*/
+
+BigInt& BigInt::operator|=(const BigInt& num)
+{
+    bitwise_operation(value, sign, num.value, num.sign,
+                      [](uint64_t a, uint64_t b) { return a | b; }, value, sign);
+    return *this;
+}
+
+/*
+    BigInt ^= BigInt
+    ----------------
+*/
+
+BigInt& BigInt::operator^=(const BigInt& num)
+{
+    bitwise_operation(value, sign, num.value, num.sign,
+                      [](uint64_t a, uint64_t b) { return a ^ b; }, value, sign);
+    return *this;
+}
+
+/*
+    ===========================================================================
+    Bit functions for BigInt
+    ===========================================================================
+*/
+
+/*
+    bit_length
+    ----------
+    Returns the number of bits in the magnitude of a BigInt (0 for zero).
+*/
+
+size_t BigInt::bit_length() const
+{
+    if (value.empty())
+        return 0;
+
+    return value.size() * 64 - __builtin_clzll(value.back());
+}
+
+/*
+    test_bit
+    --------
+    Returns bit `index` of a BigInt, least significant first, in the same
+    two's complement view as the bitwise operators. This is O(1) for
+    non-negative numbers.
+*/
+
+bool BigInt::test_bit(size_t index) const
+{
+    size_t limb_index = index / 64;
+    if (limb_index >= value.size())
+        return sign == '-';
+
+    uint64_t limb = value[limb_index];
+    if (sign == '-') {
+        // -x = ~(x - 1): the borrow reaches this limb iff all lower ones are 0
+        bool borrow = true;
+        for (size_t i = 0; i < limb_index and borrow; i++)
+            borrow = value[i] == 0;
+        limb = ~(limb - borrow);
+    }
+
+    return (limb >> (index % 64)) & 1;
+}
+
+/*
+    popcount
+    --------
+    Returns the number of 1 bits in the magnitude of a BigInt.
+*/
+
+size_t BigInt::popcount() const
+{
+    size_t count = 0;
+    for (uint64_t limb : value)
+        count += __builtin_popcountll(limb);
+
+    return count;
+}
+
 /*
     ===========================================================================
     I/O stream operators
@@ -1731,9 +3047,7 @@ std::istream& operator>>(std::istream& in, BigInt& num)
 
 std::ostream& operator<<(std::ostream& out, const BigInt& num)
 {
-    if (num.sign == '-')
-        out << num.sign;
-    out << num.value;
+    out << num.to_string();
 
     return out;
 }
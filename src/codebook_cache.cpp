@@ -0,0 +1,78 @@
+#include "codebook_cache.hpp"
+
+namespace petliukh::cryptography {
+
+Codebook_cache::Codebook_cache(size_t capacity) : m_capacity(capacity)
+{
+}
+
+// the cached tokens point into the deque, so they are not copied
+Codebook_cache::Codebook_cache(const Codebook_cache& other)
+    : m_capacity(other.m_capacity)
+{
+}
+
+Codebook_cache& Codebook_cache::operator=(const Codebook_cache& other)
+{
+    clear();
+    m_capacity = other.m_capacity;
+    return *this;
+}
+
+std::string_view Codebook_cache::find_token(char16_t chr) const
+{
+    const std::unique_ptr<Page>& page = m_pages[chr >> 8];
+    return page ? (*page)[chr & 0xFF] : std::string_view();
+}
+
+std::optional<char16_t> Codebook_cache::find_char(std::string_view token) const
+{
+    auto it = m_chars.find(token);
+    if (it == m_chars.end())
+        return std::nullopt;
+    return it->second;
+}
+
+void Codebook_cache::insert_encrypted(char16_t chr, std::string token)
+{
+    if (!find_token(chr).empty())
+        return;
+    std::string_view stored = store_(std::move(token), chr);
+    if (stored.empty())
+        return;
+
+    std::unique_ptr<Page>& page = m_pages[chr >> 8];
+    if (!page)
+        page = std::make_unique<Page>(Page{});
+    (*page)[chr & 0xFF] = stored;
+}
+
+void Codebook_cache::insert_decrypted(std::string token, char16_t chr)
+{
+    store_(std::move(token), chr);
+}
+
+void Codebook_cache::clear()
+{
+    m_chars.clear();
+    for (std::unique_ptr<Page>& page : m_pages)
+        page.reset();
+    m_tokens.clear();
+}
+
+// Keeps the token, whose characters stay in place in the deque, and maps it
+// to chr. Returns the stored token, or an empty view when the cache is full.
+std::string_view Codebook_cache::store_(std::string token, char16_t chr)
+{
+    auto it = m_chars.find(token);
+    if (it != m_chars.end())
+        return it->first;
+    if (token.empty() || m_tokens.size() >= m_capacity)
+        return std::string_view();
+
+    std::string_view stored = m_tokens.emplace_back(std::move(token));
+    m_chars.emplace(stored, chr);
+    return stored;
+}
+
+}  // namespace petliukh::cryptography
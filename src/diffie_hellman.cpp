@@ -1,11 +1,18 @@
 #include "diffie_hellman.hpp"
 #include "numeric_utils.hpp"
+#include "prime_search.hpp"
 
 namespace petliukh::cryptography {
 
-Diffie_hellman_public_pair diffie_hellman_generate_public_pair()
+Diffie_hellman_public_pair diffie_hellman_generate_public_pair(size_t digits)
 {
-    return Diffie_hellman_public_pair{ big_random(30), big_random(30) };
+    Prime_search_options options;
+    options.digits = digits;
+    options.safe = true;
+    BigInt p = find_primes(options).primes[0];
+
+    // 4 = 2^2 is a square other than 1, so its order is q
+    return Diffie_hellman_public_pair{ 4, p, p >> 1 };
 }
 
 BigInt diffie_hellman_share(
@@ -14,6 +21,20 @@ BigInt diffie_hellman_share(
     return mod_exp(dh_pair.g, secret, dh_pair.p);
 }
 
+Fixed_base_exp diffie_hellman_generator_table(
+        const Diffie_hellman_public_pair& dh_pair)
+{
+    // secrets are exponents modulo q, which is one bit shorter than p
+    BigInt q = dh_pair.q > 0 ? dh_pair.q : dh_pair.p >> 1;
+    return Fixed_base_exp(dh_pair.g, dh_pair.p, q.bit_length());
+}
+
+BigInt diffie_hellman_share(
+        const Fixed_base_exp& generator, const BigInt& secret)
+{
+    return generator.pow(secret);
+}
+
 BigInt diffie_hellman_get_common_key(
         const BigInt& shared, const BigInt& secret,
         const BigInt& modulus)
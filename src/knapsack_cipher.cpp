@@ -3,6 +3,7 @@
 #include "numeric_utils.hpp"
 #include "string_utils.hpp"
 
+#include <algorithm>
 #include <numeric>
 #include <sstream>
 #include <bitset>
@@ -34,14 +35,25 @@ std::u16string Knapsack_cipher::encrypt(const std::u16string& message)
     std::stringstream ss;
 
     for (size_t i = 0; i < message.size(); i++) {
-        BigInt c = 0;
-
-        for (size_t j = 0; j < text_keysize; j++) {
-            if (message[i] & (1 << j)) {
-                c += m_key.knapsack_seq[j];
+        std::string_view token;
+        if (m_codebook)
+            token = m_codebook->find_token(message[i]);
+
+        if (!token.empty()) {
+            ss << token;
+        } else {
+            BigInt c = 0;
+
+            for (size_t j = 0; j < text_keysize; j++) {
+                if (message[i] & (1 << j)) {
+                    c += m_key.knapsack_seq[j];
+                }
             }
+            std::string enc_token = c.to_string();
+            ss << enc_token;
+            if (m_codebook)
+                m_codebook->insert_encrypted(message[i], std::move(enc_token));
         }
-        ss << c;
 
         if (i != message.size() - 1)
             ss << m_key.separator;
@@ -51,15 +63,35 @@ std::u16string Knapsack_cipher::encrypt(const std::u16string& message)
 
 std::u16string Knapsack_cipher::decrypt(const std::u16string& message)
 {
-    std::vector<std::string> ciphertext
-            = str_split(utf16_to_utf8(message), m_key.separator);
+    std::string ciphertext = utf16_to_utf8(message);
     std::u16string decrypted_msg;
+    Barrett_reducer reducer(m_key.m);
+
+    // the numbers are parsed in place instead of being split into strings
+    const char* pos = ciphertext.data();
+    const char* end = pos + ciphertext.size();
+    while (pos != end) {
+        const char* token_end = std::find(pos, end, m_key.separator);
+        std::string_view token(pos, token_end - pos);
+        if (m_codebook) {
+            if (std::optional<char16_t> chr = m_codebook->find_char(token)) {
+                decrypted_msg += *chr;
+                pos = token_end == end ? end : token_end + 1;
+                continue;
+            }
+        }
+
+        BigInt c;
+        auto [next, error] = from_chars(pos, token_end, c);
+        if (error != std::errc() || next != token_end)
+            throw std::invalid_argument("Expected a number in the ciphertext.");
+        pos = token_end == end ? end : token_end + 1;
 
-    for (const auto& c_str: ciphertext) {
-        BigInt c = c_str;
-        BigInt c_prime = (m_key.t_inv * c) % m_key.m;
+        BigInt c_prime = reducer.mul(m_key.t_inv, c);
         char16_t dec_chr = solve_knapsack(m_key.superinc_seq, c_prime);
         decrypted_msg += dec_chr;
+        if (m_codebook)
+            m_codebook->insert_decrypted(std::string(token), dec_chr);
     }
 
     return decrypted_msg;
@@ -90,6 +122,8 @@ void Knapsack_cipher::set_key(const std::u16string& key)
     m_key.knapsack_seq = generate_knapsack_sequence(
             m_key.superinc_seq, m_key.m, m_key.t);
     m_key.t_inv = mod_inverse(m_key.t, m_key.m);
+    if (m_codebook)
+        m_codebook->clear();
 }
 
 void Knapsack_cipher::set_lang(const std::u16string& lang)
@@ -109,6 +143,8 @@ void Knapsack_cipher::generate_rand_key(size_t inc_digits)
     m_key.t_inv = mod_inverse(m_key.t, m_key.m);
     m_key.knapsack_seq
             = generate_knapsack_sequence(m_key.superinc_seq, m_key.m, m_key.t);
+    if (m_codebook)
+        m_codebook->clear();
 }
 
 
@@ -122,6 +158,14 @@ const Knapsack_cipher::Key& Knapsack_cipher::get_key() const
     return m_key;
 }
 
+void Knapsack_cipher::set_codebook_capacity(size_t capacity)
+{
+    if (capacity == 0)
+        m_codebook.reset();
+    else
+        m_codebook.emplace(capacity);
+}
+
 std::vector<BigInt> generate_superincreasing_sequence(
         size_t size, size_t start_digits, size_t inc_digits)
 {
@@ -164,9 +208,10 @@ std::vector<BigInt> generate_knapsack_sequence(
 {
     std::vector<BigInt> knapsack_seq;
     knapsack_seq.reserve(superinc_seq.size());
+    Barrett_reducer reducer(m);
 
     for (const auto& num : superinc_seq) {
-        knapsack_seq.push_back((num * t) % m);
+        knapsack_seq.push_back(reducer.mul(num, t));
     }
 
     return knapsack_seq;
@@ -1,69 +1,859 @@
 #include "numeric_utils.hpp"
 
+#include <algorithm>
+#include <random>
+#include <type_traits>
 #include <vector>
 
 namespace petliukh::cryptography {
 
-bool is_prime(const BigInt& n)
+using Double_limb = unsigned __int128;
+
+// Window width for sliding-window exponentiation. A width of w costs
+// 2^(w - 1) multiplications for the odd-power table and saves roughly
+// bits / (w + 1) multiplications in the main loop, so wider windows only
+// pay off for longer exponents.
+static size_t exponent_window_width(const BigInt& exp)
 {
-    BigInt n_sqrt = sqrt(n);
+    size_t bits = exp.bit_length();
+    if (bits <= 32)
+        return 1;
+    if (bits <= 256)
+        return 4;
+    if (bits <= 1024)
+        return 5;
+    return 6;
+}
 
-    if (n % 2 == 0)
-        return false;
+// Scans the exponent from its most significant bit and splits it into
+// zero bits and windows of at most `width` bits that start and end with a
+// one. For every bit it calls `square()`, and after each window it calls
+// `multiply(index)` with the window value v = 2 * index + 1, so that the
+// caller multiplies by the precomputed odd power base^v. Squarings that
+// would precede the first window are skipped.
+template<typename Square, typename Multiply>
+static void for_each_exponent_window(
+        const BigInt& exp, size_t width, Square square, Multiply multiply)
+{
+    bool started = false;
+    size_t i = exp.bit_length();
+
+    while (i > 0) {
+        if (!exp.test_bit(i - 1)) {
+            if (started)
+                square();
+            i--;
+            continue;
+        }
+
+        // the window covers bits [low, i), trimmed to end with a one
+        size_t low = i > width ? i - width : 0;
+        while (!exp.test_bit(low))
+            low++;
+
+        size_t value = 0;
+        for (size_t j = i; j-- > low;) {
+            value = (value << 1) | exp.test_bit(j);
+            if (started)
+                square();
+        }
+        multiply(value >> 1);
+        started = true;
+        i = low;
+    }
+}
+
+Montgomery_context::Montgomery_context(const BigInt& modulus)
+    : m_modulus(modulus)
+{
+    if (modulus <= 0 || modulus.limb(0) % 2 == 0)
+        throw std::invalid_argument("Montgomery modulus must be odd.");
 
-    for (BigInt i = 3; i <= n_sqrt; i += 2) {
-        if (n % i == 0) {
+    m_n.resize(modulus.limb_count());
+    for (size_t i = 0; i < m_n.size(); i++)
+        m_n[i] = modulus.limb(i);
+
+    // Newton's iteration for N^-1 mod 2^64: an odd number is its own inverse
+    // modulo 2^3 and every step doubles the number of correct bits
+    uint64_t inv = m_n[0];
+    for (int i = 0; i < 5; i++)
+        inv *= 2 - m_n[0] * inv;
+    m_n_prime = 0 - inv;
+
+    std::vector<uint64_t> r(m_n.size() + 1, 0);
+    r.back() = 1;
+    BigInt r_big = BigInt::from_limbs(r.data(), r.size());
+    m_r_mod_n = to_limbs(r_big % modulus);
+    m_r2_mod_n = to_limbs((r_big * r_big) % modulus);
+
+    if (modulus.bit_length() <= 63)
+        m_fixed64.emplace(Fixed_int<64>(modulus));
+    else if (modulus.bit_length() <= 127)
+        m_fixed128.emplace(Fixed_int<128>(modulus));
+}
+
+const BigInt& Montgomery_context::modulus() const
+{
+    return m_modulus;
+}
+
+BigInt Montgomery_context::to_mont(const BigInt& a) const
+{
+    BigInt reduced = a % m_modulus;
+    if (reduced < 0)
+        reduced += m_modulus;
+
+    std::vector<uint64_t> a_limbs = to_limbs(reduced);
+    std::vector<uint64_t> result(m_n.size());
+    mont_mul(a_limbs.data(), m_r2_mod_n.data(), result.data());
+    return BigInt::from_limbs(result.data(), result.size());
+}
+
+BigInt Montgomery_context::from_mont(const BigInt& a) const
+{
+    std::vector<uint64_t> a_limbs = to_limbs(a);
+    std::vector<uint64_t> one(m_n.size(), 0);
+    one[0] = 1;
+    mont_mul(a_limbs.data(), one.data(), a_limbs.data());
+    return BigInt::from_limbs(a_limbs.data(), a_limbs.size());
+}
+
+BigInt Montgomery_context::mul(const BigInt& a, const BigInt& b) const
+{
+    std::vector<uint64_t> a_limbs = to_limbs(a);
+    std::vector<uint64_t> b_limbs = to_limbs(b);
+    mont_mul(a_limbs.data(), b_limbs.data(), a_limbs.data());
+    return BigInt::from_limbs(a_limbs.data(), a_limbs.size());
+}
+
+BigInt Montgomery_context::sqr(const BigInt& a) const
+{
+    std::vector<uint64_t> a_limbs = to_limbs(a);
+    mont_mul(a_limbs.data(), a_limbs.data(), a_limbs.data());
+    return BigInt::from_limbs(a_limbs.data(), a_limbs.size());
+}
+
+BigInt Montgomery_context::pow(const BigInt& base, const BigInt& exp) const
+{
+    if (exp < 0)
+        throw std::invalid_argument("Exponent must be non-negative.");
+
+    if (m_fixed64 || m_fixed128) {
+        BigInt reduced = base % m_modulus;
+        if (reduced < 0)
+            reduced += m_modulus;
+        if (m_fixed64)
+            return m_fixed64->pow(Fixed_int<64>(reduced), exp).to_big_int();
+        return m_fixed128->pow(Fixed_int<128>(reduced), exp).to_big_int();
+    }
+
+    size_t width = exponent_window_width(exp);
+    std::vector<uint64_t> x = to_limbs(to_mont(base));
+    std::vector<uint64_t> x_sqr(m_n.size());
+    mont_mul(x.data(), x.data(), x_sqr.data());
+
+    // odd powers x, x^3, x^5, ..., x^(2^width - 1)
+    std::vector<std::vector<uint64_t>> table(size_t(1) << (width - 1), x);
+    for (size_t i = 1; i < table.size(); i++)
+        mont_mul(table[i - 1].data(), x_sqr.data(), table[i].data());
+
+    std::vector<uint64_t> acc = m_r_mod_n;
+    bool started = false;
+    for_each_exponent_window(
+            exp, width,
+            [&] { mont_mul(acc.data(), acc.data(), acc.data()); },
+            [&](size_t index) {
+                if (started)
+                    mont_mul(acc.data(), table[index].data(), acc.data());
+                else
+                    acc = table[index];
+                started = true;
+            });
+
+    return from_mont(BigInt::from_limbs(acc.data(), acc.size()));
+}
+
+// Pads a residue in [0, N) to exactly as many limbs as the modulus has.
+std::vector<uint64_t> Montgomery_context::to_limbs(const BigInt& a) const
+{
+    std::vector<uint64_t> limbs(m_n.size());
+    for (size_t i = 0; i < limbs.size(); i++)
+        limbs[i] = a.limb(i);
+    return limbs;
+}
+
+// Coarsely integrated operand scanning (CIOS): result = a * b / R mod N.
+// `result` may alias either operand.
+void Montgomery_context::mont_mul(
+        const uint64_t* a, const uint64_t* b, uint64_t* result) const
+{
+    size_t n = m_n.size();
+    // per-thread accumulator, so that the exponentiation loop does not
+    // allocate on every multiplication
+    thread_local std::vector<uint64_t> t;
+    t.assign(n + 2, 0);
+
+    for (size_t i = 0; i < n; i++) {
+        // t += a * b[i]
+        uint64_t carry = 0;
+        for (size_t j = 0; j < n; j++) {
+            Double_limb sum = (Double_limb) a[j] * b[i] + t[j] + carry;
+            t[j] = (uint64_t) sum;
+            carry = (uint64_t) (sum >> 64);
+        }
+        Double_limb sum = (Double_limb) t[n] + carry;
+        t[n] = (uint64_t) sum;
+        t[n + 1] = (uint64_t) (sum >> 64);
+
+        // t = (t + m * N) / 2^64, where m makes the lowest limb vanish
+        uint64_t m = t[0] * m_n_prime;
+        sum = (Double_limb) m * m_n[0] + t[0];
+        carry = (uint64_t) (sum >> 64);
+        for (size_t j = 1; j < n; j++) {
+            sum = (Double_limb) m * m_n[j] + t[j] + carry;
+            t[j - 1] = (uint64_t) sum;
+            carry = (uint64_t) (sum >> 64);
+        }
+        sum = (Double_limb) t[n] + carry;
+        t[n - 1] = (uint64_t) sum;
+        t[n] = t[n + 1] + (uint64_t) (sum >> 64);
+    }
+
+    // t < 2N, so a single conditional subtraction brings it below N
+    bool reduce = t[n] != 0;
+    if (!reduce) {
+        size_t j = n;
+        while (j > 0 && t[j - 1] == m_n[j - 1])
+            j--;
+        reduce = j == 0 || t[j - 1] > m_n[j - 1];
+    }
+    if (reduce) {
+        uint64_t borrow = 0;
+        for (size_t j = 0; j < n; j++) {
+            Double_limb difference = (Double_limb) t[j] - m_n[j] - borrow;
+            t[j] = (uint64_t) difference;
+            borrow = (uint64_t) (difference >> 64) & 1;
+        }
+    }
+
+    std::copy(t.begin(), t.begin() + n, result);
+}
+
+Barrett_reducer::Barrett_reducer(const BigInt& modulus)
+    : m_modulus(modulus), m_k(modulus.limb_count())
+{
+    if (modulus <= 0)
+        throw std::invalid_argument("Barrett modulus must be positive.");
+
+    std::vector<uint64_t> b_2k(2 * m_k + 1, 0);
+    b_2k.back() = 1;
+    m_mu = BigInt::from_limbs(b_2k.data(), b_2k.size()) / modulus;
+}
+
+const BigInt& Barrett_reducer::modulus() const
+{
+    return m_modulus;
+}
+
+// Returns the residue of `a` in [0, N), whatever the sign of `a`.
+BigInt Barrett_reducer::reduce(const BigInt& a) const
+{
+    if (a < 0) {
+        BigInt r = reduce(abs(a));
+        return r == 0 ? r : m_modulus - r;
+    }
+    if (a.limb_count() > 2 * m_k) {
+        return a % m_modulus;
+    }
+
+    // q underestimates floor(a / N) by at most 2 (HAC, algorithm 14.42)
+    BigInt q = ((a >> (64 * (m_k - 1))) * m_mu) >> (64 * (m_k + 1));
+    BigInt r = a - q * m_modulus;
+    while (r >= m_modulus)
+        r -= m_modulus;
+    return r;
+}
+
+BigInt Barrett_reducer::mul(const BigInt& a, const BigInt& b) const
+{
+    return reduce(a * b);
+}
+
+// Comb tables and evaluation, shared by the BigInt and fixed-width contexts.
+// Values are converted with `from_big` and `to_big`.
+template<typename Value>
+static Value from_big(const BigInt& a)
+{
+    if constexpr (std::is_same_v<Value, BigInt>)
+        return a;
+    else
+        return Value(a);
+}
+
+template<typename Value>
+static BigInt to_big(const Value& a)
+{
+    if constexpr (std::is_same_v<Value, BigInt>)
+        return a;
+    else
+        return a.to_big_int();
+}
+
+// table[i] = product of base^(2^(spacing * j)) over the bits j set in i.
+template<typename Value, typename Context>
+static std::vector<Value> build_comb_table(
+        const Context& context, const BigInt& base, size_t rows,
+        size_t spacing)
+{
+    std::vector<Value> table(size_t(1) << rows);
+    table[0] = context.to_mont(from_big<Value>(1));
+
+    Value row_base = context.to_mont(from_big<Value>(base));
+    for (size_t j = 0; j < rows; j++) {
+        size_t bit = size_t(1) << j;
+        table[bit] = row_base;
+        for (size_t i = 1; i < bit; i++)
+            table[bit + i] = context.mul(table[i], row_base);
+        for (size_t k = 0; k < spacing && j + 1 < rows; k++)
+            row_base = context.mul(row_base, row_base);
+    }
+    return table;
+}
+
+template<typename Value, typename Context>
+static BigInt comb_pow(
+        const Context& context, const std::vector<Value>& table,
+        const BigInt& exp, size_t rows, size_t spacing)
+{
+    Value acc = table[0];
+    bool started = false;
+    for (size_t column = spacing; column-- > 0;) {
+        if (started)
+            acc = context.mul(acc, acc);
+
+        size_t index = 0;
+        for (size_t j = 0; j < rows; j++) {
+            if (exp.test_bit(column + spacing * j))
+                index |= size_t(1) << j;
+        }
+        if (index != 0) {
+            acc = started ? context.mul(acc, table[index]) : table[index];
+            started = true;
+        }
+    }
+    return to_big(context.from_mont(acc));
+}
+
+Fixed_base_exp::Fixed_base_exp(
+        const BigInt& base, const BigInt& modulus, size_t max_exp_bits)
+    : m_base(base), m_modulus(modulus)
+{
+    if (modulus <= 0 || !modulus.test_bit(0))
+        throw std::invalid_argument("Montgomery modulus must be odd.");
+
+    // more rows cost 2^h table entries but save squarings
+    size_t bits = max_exp_bits ? max_exp_bits : modulus.bit_length();
+    m_rows = bits <= 64 ? 4 : bits <= 256 ? 6 : 8;
+    m_spacing = (bits + m_rows - 1) / m_rows;
+
+    BigInt reduced = base % modulus;
+    if (reduced < 0)
+        reduced += modulus;
+
+    size_t modulus_bits = modulus.bit_length();
+    if (modulus_bits <= 63) {
+        Fixed_montgomery<64> context{ Fixed_int<64>(modulus) };
+        m_comb64.emplace(Comb<Fixed_montgomery<64>, Fixed_int<64>>{
+                context, build_comb_table<Fixed_int<64>>(
+                                 context, reduced, m_rows, m_spacing) });
+    } else if (modulus_bits <= 127) {
+        Fixed_montgomery<128> context{ Fixed_int<128>(modulus) };
+        m_comb128.emplace(Comb<Fixed_montgomery<128>, Fixed_int<128>>{
+                context, build_comb_table<Fixed_int<128>>(
+                                 context, reduced, m_rows, m_spacing) });
+    } else {
+        Montgomery_context context(modulus);
+        std::vector<BigInt> table
+                = build_comb_table<BigInt>(context, reduced, m_rows, m_spacing);
+        m_comb.emplace(Comb<Montgomery_context, BigInt>{
+                std::move(context), std::move(table) });
+    }
+}
+
+const BigInt& Fixed_base_exp::base() const
+{
+    return m_base;
+}
+
+const BigInt& Fixed_base_exp::modulus() const
+{
+    return m_modulus;
+}
+
+BigInt Fixed_base_exp::pow(const BigInt& exp) const
+{
+    if (exp < 0)
+        throw std::invalid_argument("Exponent must be non-negative.");
+    if (exp.bit_length() > m_rows * m_spacing)
+        return mod_exp(m_base, exp, m_modulus);
+
+    if (m_comb64)
+        return comb_pow(
+                m_comb64->context, m_comb64->table, exp, m_rows, m_spacing);
+    if (m_comb128)
+        return comb_pow(
+                m_comb128->context, m_comb128->table, exp, m_rows, m_spacing);
+    return comb_pow(m_comb->context, m_comb->table, exp, m_rows, m_spacing);
+}
+
+BigInt mod_inverse(const BigInt& A, const BigInt& M)
+{
+    if (M <= 0)
+        return mod_inverse<BigInt>(A, M);
+
+    BigInt reduced = A % M;
+    if (reduced < 0)
+        reduced += M;
+
+    // one bit of headroom is left, as the template adds M to its result
+    if (M.bit_length() <= 62)
+        return mod_inverse<long long>(reduced.to_long_long(), M.to_long_long());
+    if (M.bit_length() <= 126)
+        return mod_inverse<Fixed_int<128>>(
+                       Fixed_int<128>(reduced), Fixed_int<128>(M))
+                .to_big_int();
+
+    return mod_inverse<BigInt>(reduced, M);
+}
+
+int jacobi(BigInt a, BigInt n)
+{
+    if (n <= 0 || !n.test_bit(0))
+        throw std::invalid_argument("Jacobi symbol needs an odd positive n.");
+
+    a %= n;
+    if (a < 0)
+        a += n;
+
+    int result = 1;
+    while (a != 0) {
+        size_t zeros = 0;
+        while (!a.test_bit(zeros))
+            zeros++;
+        a >>= zeros;
+
+        // (2 / n) = -1 exactly when n = 3 or 5 (mod 8)
+        uint64_t n_mod_8 = n.limb(0) & 7;
+        if ((zeros & 1) && (n_mod_8 == 3 || n_mod_8 == 5))
+            result = -result;
+
+        // quadratic reciprocity
+        std::swap(a, n);
+        if ((a.limb(0) & 3) == 3 && (n.limb(0) & 3) == 3)
+            result = -result;
+        a %= n;
+    }
+
+    return n == 1 ? result : 0;
+}
+
+// Strong probable prime test of an odd n > 2 below 2^64 to the given base.
+static bool is_strong_probable_prime(uint64_t n, uint64_t base)
+{
+    base %= n;
+    if (base == 0)
+        return true;
+
+    uint64_t d = n - 1;
+    size_t s = 0;
+    while (d % 2 == 0) {
+        d /= 2;
+        s++;
+    }
+
+    uint64_t x = 1;
+    for (uint64_t b = base; d > 0; d /= 2) {
+        if (d & 1)
+            x = (Double_limb) x * b % n;
+        b = (Double_limb) b * b % n;
+    }
+    if (x == 1 || x == n - 1)
+        return true;
+
+    for (size_t i = 1; i < s; i++) {
+        x = (Double_limb) x * x % n;
+        if (x == n - 1)
+            return true;
+    }
+    return false;
+}
+
+// Strong probable prime test of an odd n to the given base, where
+// n - 1 = d * 2^s and `mont` works modulo n.
+static bool is_strong_probable_prime(
+        const Montgomery_context& mont, const BigInt& d, size_t s,
+        const BigInt& base)
+{
+    const BigInt& n = mont.modulus();
+    BigInt x = mont.pow(base, d);
+    if (x == 1 || x == n - 1)
+        return true;
+
+    BigInt one = mont.to_mont(1);
+    BigInt minus_one = mont.to_mont(n - 1);
+    x = mont.to_mont(x);
+    for (size_t i = 1; i < s; i++) {
+        x = mont.sqr(x);
+        if (x == minus_one)
+            return true;
+        if (x == one)
+            return false;
+    }
+    return false;
+}
+
+// Strong Lucas probable prime test of an odd n that is not a perfect square,
+// with the parameters of Selfridge's method A: D is the first of
+// 5, -7, 9, -11, ... with (D / n) = -1, P = 1 and Q = (1 - D) / 4. The
+// sequences are computed in Montgomery form, which is compatible with
+// addition and halving modulo n.
+static bool is_strong_lucas_probable_prime(
+        const Montgomery_context& mont)
+{
+    const BigInt& n = mont.modulus();
+
+    long long D = 5;
+    while (true) {
+        int symbol = jacobi(D, n);
+        if (symbol == -1)
+            break;
+        if (symbol == 0 && abs(BigInt(D)) != n)
             return false;
+        // no D exists for perfect squares, so check for one once the
+        // search takes longer than it does for almost all other numbers
+        if (D == 13) {
+            BigInt root = isqrt(n);
+            if (root * root == n)
+                return false;
+        }
+        D = D > 0 ? -(D + 2) : -D + 2;
+    }
+
+    auto reduce = [&](BigInt a) {
+        a %= n;
+        return a < 0 ? a + n : a;
+    };
+    auto add = [&](const BigInt& a, const BigInt& b) {
+        BigInt sum = a + b;
+        return sum >= n ? sum - n : sum;
+    };
+    auto subtract = [&](const BigInt& a, const BigInt& b) {
+        BigInt difference = a - b;
+        return difference < 0 ? difference + n : difference;
+    };
+    auto half = [&](BigInt a) {
+        if (a.test_bit(0))
+            a += n;
+        return a >> 1;
+    };
+
+    BigInt d = n + 1;
+    size_t s = 0;
+    while (!d.test_bit(s))
+        s++;
+    d >>= s;
+
+    BigInt d_mont = mont.to_mont(reduce(D));
+    BigInt q_mont = mont.to_mont(reduce(BigInt(1 - D) / 4));
+
+    // U_1 = 1, V_1 = P = 1, Q^1
+    BigInt u = mont.to_mont(1), v = u, q_k = q_mont;
+    for (size_t i = d.bit_length() - 1; i-- > 0;) {
+        // U_2k = U_k V_k, V_2k = V_k^2 - 2 Q^k
+        u = mont.mul(u, v);
+        v = subtract(mont.sqr(v), add(q_k, q_k));
+        q_k = mont.sqr(q_k);
+        if (d.test_bit(i)) {
+            // U_k+1 = (P U_k + V_k) / 2, V_k+1 = (D U_k + P V_k) / 2
+            BigInt next_u = half(add(u, v));
+            v = half(add(mont.mul(d_mont, u), v));
+            u = std::move(next_u);
+            q_k = mont.mul(q_k, q_mont);
+        }
+    }
+
+    if (u == 0 || v == 0)
+        return true;
+    for (size_t r = 1; r < s; r++) {
+        v = subtract(mont.sqr(v), add(q_k, q_k));
+        if (v == 0)
+            return true;
+        q_k = mont.sqr(q_k);
+    }
+    return false;
+}
+
+bool is_prime(const BigInt& n, size_t rounds, Primality_test test)
+{
+    if (n < 2)
+        return false;
+
+    // trial division by the odd primes below 50, with one BigInt division
+    static const uint64_t small_primes[] = { 3,  5,  7,  11, 13, 17, 19,
+                                             23, 29, 31, 37, 41, 43, 47 };
+    static const long long small_primes_product = 307444891294245705LL;
+    if (!n.test_bit(0))
+        return n == 2;
+    uint64_t residue = (n % small_primes_product).to_long_long();
+    for (uint64_t p : small_primes) {
+        if (residue % p == 0)
+            return n == p;
+    }
+    if (n < 47 * 47)
+        return true;
+
+    // these bases decide every n below 2^64
+    if (n.bit_length() <= 64) {
+        for (uint64_t base : { 2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37 }) {
+            if (!is_strong_probable_prime(n.limb(0), base))
+                return false;
         }
+        return true;
     }
 
+    Montgomery_context mont(n);
+    BigInt d = n - 1;
+    size_t s = 0;
+    while (!d.test_bit(s))
+        s++;
+    d >>= s;
+
+    if (test == Primality_test::bpsw) {
+        return is_strong_probable_prime(mont, d, s, 2)
+               && is_strong_lucas_probable_prime(mont);
+    }
+
+    // random bases in [2, n - 2]
+    std::random_device seed;
+    std::mt19937_64 rng((uint64_t) seed() << 32 | seed());
+    std::vector<uint64_t> limbs(n.limb_count() + 1);
+    for (size_t i = 0; i < rounds; i++) {
+        for (uint64_t& limb : limbs)
+            limb = rng();
+        BigInt base = BigInt::from_limbs(limbs.data(), limbs.size()) % (n - 3)
+                      + 2;
+        if (!is_strong_probable_prime(mont, d, s, base))
+            return false;
+    }
     return true;
 }
 
-// Function to return nearest prime number
-BigInt nearest_prime(BigInt n)
+// Number of odd candidates sieved at a time.
+static const size_t SIEVE_SEGMENT_SIZE = 4096;
+// Candidates below 2^SIEVE_MIN_BITS are not sieved, so that no sieving prime
+// is ever marked as a multiple of itself.
+static const size_t SIEVE_MIN_BITS = 32;
+
+// The odd primes below 2^15, generated once by the sieve of Eratosthenes.
+static const std::vector<uint32_t>& small_odd_primes()
 {
-    // All prime numbers are odd except two
-    if (n % 2 == 0)
-        n -= 2;
-    else
-        n--;
+    static const std::vector<uint32_t> primes = [] {
+        const uint32_t limit = 1 << 15;
+        std::vector<bool> composite(limit);
+        std::vector<uint32_t> result;
+        for (uint32_t i = 3; i < limit; i += 2) {
+            if (composite[i])
+                continue;
+            result.push_back(i);
+            for (uint32_t j = i * i; j < limit; j += 2 * i)
+                composite[j] = true;
+        }
+        return result;
+    }();
+    return primes;
+}
 
-    BigInt i, j;
-    for (i = n; i >= 2; i -= 2) {
-        if (i % 2 == 0)
-            continue;
-        for (j = 3; j <= sqrt(i); j += 2) {
-            if (i % j == 0)
-                break;
+Prime_sieve::Prime_sieve(
+        const BigInt& start, Direction direction, bool sophie_germain)
+    : m_base(start),
+      m_direction(direction),
+      m_sophie_germain(sophie_germain),
+      m_index(0)
+{
+    if (!m_base.test_bit(0))
+        m_base += direction == Direction::up ? 1 : -1;
+
+    // the residues of several primes at once, with one BigInt division for
+    // each group whose product fits in a long long
+    const std::vector<uint32_t>& primes = small_odd_primes();
+    m_residues.resize(primes.size());
+    for (size_t i = 0; i < primes.size();) {
+        size_t end = i;
+        long long product = 1;
+        while (end < primes.size() && product <= (1LL << 62) / primes[end])
+            product *= primes[end++];
+
+        BigInt remainder = m_base % product;
+        if (remainder < 0)
+            remainder += product;
+        uint64_t residue = remainder.to_long_long();
+        for (; i < end; i++)
+            m_residues[i] = residue % primes[i];
+    }
+
+    sieve_segment();
+}
+
+// Marks the candidates of the segment at m_base that have a small prime
+// factor.
+void Prime_sieve::sieve_segment()
+{
+    m_composite.assign(SIEVE_SEGMENT_SIZE, false);
+    m_index = 0;
+    if (m_base.bit_length() <= SIEVE_MIN_BITS)
+        return;
+
+    const std::vector<uint32_t>& primes = small_odd_primes();
+    bool up = m_direction == Direction::up;
+    for (size_t i = 0; i < primes.size(); i++) {
+        // candidate k is m_base + 2k (or m_base - 2k going down), which is
+        // divisible by p when 2k = -r (or r) modulo p
+        uint64_t p = primes[i], r = m_residues[i], half = (p + 1) / 2;
+        uint64_t k = (up ? (p - r) % p : r) * half % p;
+        for (; k < SIEVE_SEGMENT_SIZE; k += p)
+            m_composite[k] = true;
+
+        // 2q + 1 is divisible by p when q = (p - 1) / 2 modulo p
+        if (m_sophie_germain) {
+            uint64_t target = (p - 1) / 2;
+            k = (up ? (target + p - r) % p : (r + p - target) % p) * half % p;
+            for (; k < SIEVE_SEGMENT_SIZE; k += p)
+                m_composite[k] = true;
         }
-        if (j > sqrt(i))
-            return i;
     }
-    // It will only be executed when n is 3
-    return 2;
 }
 
-BigInt mod_exp(const BigInt& a, BigInt e, const BigInt& m)
+BigInt Prime_sieve::next()
 {
-    std::vector<BigInt> mods;
-    std::vector<BigInt> pows;
-    mods.push_back(a % m);
-    pows.push_back(1);
+    while (true) {
+        if (m_index == SIEVE_SEGMENT_SIZE) {
+            // move on to the following segment
+            const std::vector<uint32_t>& primes = small_odd_primes();
+            uint64_t shift = 2 * SIEVE_SEGMENT_SIZE;
+            bool up = m_direction == Direction::up;
+            m_base += up ? (long long) shift : -(long long) shift;
+            for (size_t i = 0; i < primes.size(); i++) {
+                uint64_t p = primes[i], r = m_residues[i];
+                m_residues[i] = up ? (r + shift) % p : (r + p - shift % p) % p;
+            }
+            sieve_segment();
+        }
+
+        size_t k = m_index++;
+        if (!m_composite[k]) {
+            long long offset = 2 * (long long) k;
+            return m_direction == Direction::up ? m_base + offset
+                                                : m_base - offset;
+        }
+    }
+}
+
+BigInt next_prime(const BigInt& n)
+{
+    if (n < 2)
+        return 2;
 
-    while (pows.back() < e) {
-        mods.push_back((mods.back() * mods.back()) % m);
-        pows.push_back(pows.back() * 2);
+    Prime_sieve sieve(n + 1);
+    while (true) {
+        BigInt candidate = sieve.next();
+        if (is_prime(candidate))
+            return candidate;
     }
-    BigInt mod = 1;
+}
+
+BigInt prev_prime(const BigInt& n)
+{
+    if (n <= 2)
+        throw std::invalid_argument("There is no prime below the number.");
+    if (n == 3)
+        return 2;
+
+    Prime_sieve sieve(n - 1, Prime_sieve::Direction::down);
+    while (true) {
+        BigInt candidate = sieve.next();
+        if (candidate < 3)
+            return 2;
+        if (is_prime(candidate))
+            return candidate;
+    }
+}
 
-    for (int i = mods.size() - 1; i >= 0; i--) {
-        if (e >= pows[i]) {
-            mod *= mods[i];
-            e -= pows[i];
+BigInt nearest_prime(BigInt n)
+{
+    return n <= 3 ? BigInt(2) : prev_prime(n);
+}
+
+BigInt mod_exp(const BigInt& a, const BigInt& e, const BigInt& m)
+{
+    if (m <= 0)
+        throw std::invalid_argument("Modulus must be positive.");
+    if (e < 0)
+        throw std::invalid_argument("Exponent must be non-negative.");
+    if (m == 1)
+        return 0;
+
+    // moduli that fit in machine words skip BigInt arithmetic altogether
+    size_t m_bits = m.bit_length();
+    if (m_bits <= 127) {
+        BigInt base = a % m;
+        if (base < 0)
+            base += m;
+
+        if (m.test_bit(0) && m_bits <= 63) {
+            return Fixed_montgomery<64>(Fixed_int<64>(m))
+                    .pow(Fixed_int<64>(base), e)
+                    .to_big_int();
+        }
+        if (m.test_bit(0)) {
+            return Fixed_montgomery<128>(Fixed_int<128>(m))
+                    .pow(Fixed_int<128>(base), e)
+                    .to_big_int();
+        }
+        if (m_bits <= 64) {
+            uint64_t modulus = m.limb(0), x = base.limb(0), result = 1;
+            for (size_t i = e.bit_length(); i-- > 0;) {
+                result = (Double_limb) result * result % modulus;
+                if (e.test_bit(i))
+                    result = (Double_limb) result * x % modulus;
+            }
+            return BigInt::from_limbs(&result, 1);
         }
     }
-    return mod % m;
+
+    if (m.test_bit(0))
+        return Montgomery_context(m).pow(a, e);
+
+    // even modulus: the same windows over residues reduced by Barrett
+    Barrett_reducer reducer(m);
+    size_t width = exponent_window_width(e);
+    BigInt x = reducer.reduce(a);
+    BigInt x_sqr = reducer.mul(x, x);
+
+    std::vector<BigInt> table(size_t(1) << (width - 1));
+    table[0] = x;
+    for (size_t i = 1; i < table.size(); i++)
+        table[i] = reducer.mul(table[i - 1], x_sqr);
+
+    BigInt acc = BigInt(1) % m;
+    bool started = false;
+    for_each_exponent_window(
+            e, width,
+            [&] { acc = reducer.mul(acc, acc); },
+            [&](size_t index) {
+                acc = started ? reducer.mul(acc, table[index]) : table[index];
+                started = true;
+            });
+    return acc;
 }
 
 }  // namespace petliukh::cryptography
@@ -0,0 +1,129 @@
+#include "prime_search.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <mutex>
+#include <random>
+#include <thread>
+
+namespace petliukh::cryptography {
+
+// Number of odd candidates in a search window. Short windows keep the workers
+// busy with one prime each; a few thousand sieved candidates would leave most
+// of them idle. Sieving for safe primes leaves about eight times fewer
+// candidates, so their windows are longer.
+static const size_t SEARCH_WINDOW_SIZE = 32;
+static const size_t SAFE_SEARCH_WINDOW_SIZE = 256;
+
+namespace {
+
+// The search for one prime, shared by the workers.
+struct Search_slot {
+    BigInt start;
+    std::atomic<size_t> next_window{ 0 };
+    std::atomic<size_t> found_window{ std::numeric_limits<size_t>::max() };
+    std::mutex mutex;
+    BigInt prime;
+};
+
+}  // namespace
+
+// Tests a candidate q, which for safe primes stands for 2q + 1. One round on
+// each number comes first, as q is often prime while 2q + 1 is not.
+static bool is_search_candidate_prime(
+        const BigInt& q, const Prime_search_options& options)
+{
+    if (!options.safe)
+        return is_prime(q, options.rounds, options.test);
+
+    BigInt p = q * 2 + 1;
+    return is_prime(q, 1) && is_prime(p, 1)
+           && is_prime(q, options.rounds, options.test)
+           && is_prime(p, options.rounds, options.test);
+}
+
+// Takes windows of the slot until one at or after a window with a prime comes
+// up. Returns once there is nothing left to do in the slot.
+static void search_slot(
+        Search_slot& slot, const Prime_search_options& options)
+{
+    while (true) {
+        size_t window = slot.next_window++;
+        if (window >= slot.found_window)
+            return;
+
+        size_t size = options.safe ? SAFE_SEARCH_WINDOW_SIZE
+                                   : SEARCH_WINDOW_SIZE;
+        long long offset = 2 * (long long) (size * window);
+        BigInt end = slot.start + offset + 2 * (long long) size;
+        Prime_sieve sieve(
+                slot.start + offset, Prime_sieve::Direction::up,
+                options.safe);
+
+        for (BigInt candidate = sieve.next(); candidate < end;
+             candidate = sieve.next()) {
+            // an earlier window has already found a prime
+            if (window >= slot.found_window)
+                return;
+            if (!is_search_candidate_prime(candidate, options))
+                continue;
+
+            std::lock_guard<std::mutex> lock(slot.mutex);
+            if (window < slot.found_window) {
+                slot.found_window = window;
+                slot.prime = options.safe ? candidate * 2 + 1 : candidate;
+            }
+            break;
+        }
+    }
+}
+
+Prime_search_result find_primes(const Prime_search_options& options)
+{
+    Prime_search_result result;
+    result.seed = options.seed ? *options.seed : [] {
+        std::random_device seed;
+        return (uint64_t) seed() << 32 | seed();
+    }();
+
+    std::mt19937_64 generator(result.seed);
+    std::vector<Search_slot> slots(options.count);
+    for (Search_slot& slot : slots) {
+        slot.start = big_random(options.digits, generator);
+        if (options.safe)
+            slot.start >>= 1;
+        // 2 is the only prime (or q of a safe prime) that the odd windows
+        // would miss
+        if (slot.start <= 2) {
+            slot.prime = options.safe ? 5 : 2;
+            slot.found_window = 0;
+        } else if (!slot.start.test_bit(0)) {
+            slot.start++;
+        }
+    }
+
+    size_t threads = options.threads;
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    // worker i starts on prime i mod count and moves on to the others once
+    // that one is settled, so that every prime is searched in parallel
+    auto work = [&](size_t worker) {
+        for (size_t i = 0; i < slots.size(); i++)
+            search_slot(slots[(worker + i) % slots.size()], options);
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < threads; i++)
+        workers.emplace_back(work, i);
+    work(0);
+    for (std::thread& worker : workers)
+        worker.join();
+
+    for (Search_slot& slot : slots)
+        result.primes.push_back(std::move(slot.prime));
+    return result;
+}
+
+}  // namespace petliukh::cryptography
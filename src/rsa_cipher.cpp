@@ -1,8 +1,11 @@
 #include "rsa_cipher.hpp"
 
 #include "numeric_utils.hpp"
+#include "prime_search.hpp"
 #include "string_utils.hpp"
+#include <algorithm>
 #include <cassert>
+#include <iterator>
 
 namespace petliukh::cryptography {
 
@@ -14,14 +17,65 @@ Rsa_cipher::~Rsa_cipher()
 {
 }
 
+// Length of the prefix that records the number of message bytes in blocks.
+static const size_t BLOCK_LENGTH_PREFIX = 8;
+
+// Big-endian conversions between bytes and numbers.
+static BigInt bytes_to_number(const char* data, size_t size)
+{
+    std::vector<uint64_t> limbs((size + 7) / 8);
+    for (size_t i = 0; i < size; i++) {
+        uint64_t byte = static_cast<unsigned char>(data[size - 1 - i]);
+        limbs[i / 8] |= byte << (8 * (i % 8));
+    }
+    return BigInt::from_limbs(limbs.data(), limbs.size());
+}
+
+static void append_number_bytes(
+        const BigInt& num, size_t size, std::string& result)
+{
+    for (size_t i = size; i-- > 0;) {
+        uint64_t limb = num.limb(i / 8);
+        result += static_cast<char>(limb >> (8 * (i % 8)));
+    }
+}
+
 std::u16string Rsa_cipher::encrypt(const std::u16string& message)
 {
     std::stringstream ss;
 
+    if (m_mode == Mode::block) {
+        // code units are packed as two big-endian bytes each
+        std::string bytes;
+        for (char16_t chr : message) {
+            bytes += static_cast<char>(chr >> 8);
+            bytes += static_cast<char>(chr & 0xFF);
+        }
+
+        std::vector<BigInt> blocks = encrypt_blocks_(bytes);
+        for (size_t i = 0; i < blocks.size(); i++) {
+            ss << blocks[i];
+            if (i != blocks.size() - 1)
+                ss << " ";
+        }
+        return utf8_to_utf16(ss.str());
+    }
+
     for (int i = 0; i < message.size(); i++) {
-        BigInt enc_chr(static_cast<int16_t>(message[i]));
-        enc_chr = mod_exp(enc_chr, m_key.e, m_key.N);
-        ss << enc_chr;
+        std::string_view token;
+        if (m_codebook)
+            token = m_codebook->find_token(message[i]);
+
+        if (!token.empty()) {
+            ss << token;
+        } else {
+            BigInt enc_chr(static_cast<long long>(message[i]));
+            enc_chr = mont_().pow(enc_chr, m_key.e);
+            std::string enc_token = enc_chr.to_string();
+            ss << enc_token;
+            if (m_codebook)
+                m_codebook->insert_encrypted(message[i], std::move(enc_token));
+        }
 
         if (i != message.size() - 1)
             ss << " ";
@@ -32,45 +86,108 @@ std::u16string Rsa_cipher::encrypt(const std::u16string& message)
 
 std::u16string Rsa_cipher::decrypt(const std::u16string& message)
 {
-    std::vector<std::string> ciphertex = str_split(utf16_to_utf8(message), ' ');
+    std::string ciphertext = utf16_to_utf8(message);
     std::u16string plaintext;
+    std::vector<BigInt> blocks;
+
+    // the numbers are parsed in place instead of being split into strings
+    bool use_codebook = m_codebook && m_mode == Mode::per_character;
+    const char* pos = ciphertext.data();
+    const char* end = pos + ciphertext.size();
+    while (pos != end) {
+        const char* token_end = std::find(pos, end, ' ');
+        std::string_view token(pos, token_end - pos);
+        if (use_codebook) {
+            if (std::optional<char16_t> chr = m_codebook->find_char(token)) {
+                plaintext += *chr;
+                pos = token_end == end ? end : token_end + 1;
+                continue;
+            }
+        }
 
-    for (const std::string& num: ciphertex) {
-        BigInt c(num);
-        BigInt dec = mod_exp(c, m_key.d, m_key.N);
+        BigInt c;
+        auto [next, error] = from_chars(pos, token_end, c);
+        if (error != std::errc() || next != token_end)
+            throw std::invalid_argument("Expected a number in the ciphertext.");
+        pos = token_end == end ? end : token_end + 1;
+
+        if (m_mode == Mode::block) {
+            blocks.push_back(std::move(c));
+            continue;
+        }
+
+        BigInt dec = decrypt_number_(c);
+        // code units u from 0x8000 used to be encrypted as the negative
+        // int16_t u - 0x10000, which now decrypts to N + u - 0x10000
+        if (dec > 0xFFFF)
+            dec = dec - m_key.N + 0x10000;
+        if (dec < 0 || dec > 0xFFFF)
+            throw std::invalid_argument(
+                    "Ciphertext does not decrypt to a UTF-16 code unit.");
         char16_t chr = static_cast<char16_t>(dec.to_int());
         plaintext += chr;
+        if (use_codebook)
+            m_codebook->insert_decrypted(std::string(token), chr);
+    }
+
+    if (m_mode == Mode::block) {
+        std::string bytes = decrypt_blocks_(blocks);
+        if (bytes.size() % 2 != 0)
+            throw std::invalid_argument("Odd number of bytes in UTF-16 text.");
+        for (size_t i = 0; i < bytes.size(); i += 2) {
+            plaintext += static_cast<char16_t>(
+                    static_cast<unsigned char>(bytes[i]) << 8
+                    | static_cast<unsigned char>(bytes[i + 1]));
+        }
     }
     return plaintext;
 }
 
 std::string Rsa_cipher::encrypt_raw_bytes(const std::string& bytes)
 {
-    return "";
+    size_t number_size = (mont_().modulus().bit_length() + 7) / 8;
+    std::string result;
+    for (const BigInt& block : encrypt_blocks_(bytes))
+        append_number_bytes(block, number_size, result);
+    return result;
 }
 
 std::string Rsa_cipher::decrypt_raw_bytes(const std::string& bytes)
 {
-    return "";
+    size_t number_size = (mont_().modulus().bit_length() + 7) / 8;
+    if (bytes.size() % number_size != 0)
+        throw std::invalid_argument("Ciphertext is not a whole number of blocks.");
+
+    std::vector<BigInt> blocks;
+    for (size_t i = 0; i < bytes.size(); i += number_size)
+        blocks.push_back(bytes_to_number(bytes.data() + i, number_size));
+    return decrypt_blocks_(blocks);
 }
 
 void Rsa_cipher::set_key(const std::u16string& key)
 {
-    std::vector<std::string> primes = str_split(utf16_to_utf8(key), ' ');
+    std::vector<std::string> tokens = str_split(utf16_to_utf8(key), ' ');
+    std::vector<BigInt> primes(tokens.begin(), tokens.end());
+    if (primes.size() < 2)
+        throw std::invalid_argument("RSA key needs at least two primes.");
+    // the Montgomery contexts of N and of every prime need odd moduli
+    for (const BigInt& prime : primes) {
+        if (prime < 3 || prime % 2 == 0)
+            throw std::invalid_argument("RSA primes must be odd.");
+    }
 
-    m_key.p = BigInt(primes[0]);
-    m_key.q = BigInt(primes[1]);
+    std::vector<BigInt> sorted = primes;
+    std::sort(sorted.begin(), sorted.end());
+    if (std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end())
+        throw std::invalid_argument("RSA primes must be distinct.");
 
-    m_key.N = m_key.p * m_key.q;
-    m_key.phi = (m_key.p - 1) * (m_key.q - 1);
-    m_key.e = 2;
+    m_key.p = primes[0];
+    m_key.q = primes[1];
+    m_key.other_primes.clear();
+    for (size_t i = 2; i < primes.size(); i++)
+        m_key.other_primes.push_back({ primes[i], 0, 0 });
 
-    while ((gcd(m_key.e, m_key.N) != 1 || gcd(m_key.e, m_key.phi) != 1)
-           && m_key.e < m_key.phi) {
-        m_key.e++;
-    }
-
-    m_key.d = mod_inverse(m_key.e, m_key.phi);
+    derive_key_();
 }
 
 Rsa_cipher::Key Rsa_cipher::get_key() const
@@ -78,10 +195,25 @@ Rsa_cipher::Key Rsa_cipher::get_key() const
     return m_key;
 }
 
+void Rsa_cipher::set_mode(Mode mode)
+{
+    m_mode = mode;
+}
+
+void Rsa_cipher::set_codebook_capacity(size_t capacity)
+{
+    if (capacity == 0)
+        m_codebook.reset();
+    else
+        m_codebook.emplace(capacity);
+}
+
 std::string Rsa_cipher::Key::to_string() const
 {
     std::stringstream ss;
     ss << p << " " << q;
+    for (const Prime_info& info : other_primes)
+        ss << " " << info.r;
     return ss.str();
 }
 
@@ -93,24 +225,58 @@ void Rsa_cipher::set_lang(const Language& lang)
 {
 }
 
-void Rsa_cipher::generate_rand_key(size_t key_digits)
+// Number of primes of each length up to five digits. The search for a prime
+// of d digits starts at a d-digit number, so at least these many distinct
+// ones can come up; from six digits on there are tens of thousands.
+static const size_t PRIMES_WITH_DIGITS[] = { 0, 4, 21, 143, 1061, 8363 };
+
+void Rsa_cipher::generate_rand_key(size_t key_digits, size_t num_primes)
 {
-    m_key.p = big_random(key_digits);
-    m_key.q = big_random(key_digits);
+    if (num_primes < 2)
+        throw std::invalid_argument("RSA key needs at least two primes.");
 
-    if (m_key.p % 2 == 0)
-        m_key.p--;
-    if (m_key.q % 2 == 0)
-        m_key.q--;
+    // a single digit would let the search come up with 2
+    size_t digits = 2 * key_digits / num_primes;
+    if (digits < 2)
+        throw std::invalid_argument(
+                "RSA key is too short for that many primes.");
+    if (digits < std::size(PRIMES_WITH_DIGITS)
+        && num_primes > PRIMES_WITH_DIGITS[digits])
+        throw std::invalid_argument(
+                "There are not that many distinct primes of that length.");
 
-    while (!is_prime(m_key.p)) {
-        m_key.p -= 2;
-    }
-    while (!is_prime(m_key.q)) {
-        m_key.q -= 2;
+    // a repeated prime is replaced by searching again from new starting
+    // points, keeping the distinct ones found so far
+    Prime_search_options options;
+    options.digits = digits;
+    std::vector<BigInt> primes;
+    while (primes.size() < num_primes) {
+        options.count = num_primes - primes.size();
+        for (BigInt& prime : find_primes(options).primes) {
+            if (std::find(primes.begin(), primes.end(), prime) == primes.end())
+                primes.push_back(std::move(prime));
+        }
     }
+
+    m_key.p = std::move(primes[0]);
+    m_key.q = std::move(primes[1]);
+    m_key.other_primes.clear();
+    for (size_t i = 2; i < primes.size(); i++)
+        m_key.other_primes.push_back({ std::move(primes[i]), 0, 0 });
+
+    derive_key_();
+}
+
+// Derives the rest of the key from its primes, and sets up the Montgomery
+// contexts for N and every prime once so that every character reuses them.
+void Rsa_cipher::derive_key_()
+{
     m_key.N = m_key.p * m_key.q;
     m_key.phi = (m_key.p - 1) * (m_key.q - 1);
+    for (const Key::Prime_info& info : m_key.other_primes) {
+        m_key.N *= info.r;
+        m_key.phi *= info.r - 1;
+    }
     m_key.e = 2;
 
     while ((gcd(m_key.e, m_key.N) != 1 || gcd(m_key.e, m_key.phi) != 1)
@@ -119,6 +285,109 @@ void Rsa_cipher::generate_rand_key(size_t key_digits)
     }
 
     m_key.d = mod_inverse(m_key.e, m_key.phi);
+    m_key.d_p = m_key.d % (m_key.p - 1);
+    m_key.d_q = m_key.d % (m_key.q - 1);
+    m_key.q_inv = mod_inverse(m_key.q, m_key.p);
+
+    m_mont.emplace(m_key.N);
+    if (m_codebook)
+        m_codebook->clear();
+    m_crt.clear();
+    m_crt.push_back({ Montgomery_context(m_key.q), m_key.d_q, 0, 1 });
+    Montgomery_context mont_p(m_key.p);
+    BigInt q_inv_mont = mont_p.to_mont(m_key.q_inv);
+    m_crt.push_back({ std::move(mont_p), m_key.d_p, std::move(q_inv_mont),
+                      m_key.q });
+
+    BigInt product = m_key.p * m_key.q;
+    for (Key::Prime_info& info : m_key.other_primes) {
+        info.d = m_key.d % (info.r - 1);
+        info.t = mod_inverse(product % info.r, info.r);
+
+        Montgomery_context mont(info.r);
+        BigInt coefficient_mont = mont.to_mont(info.t);
+        m_crt.push_back({ std::move(mont), info.d,
+                          std::move(coefficient_mont), product });
+        product *= info.r;
+    }
+}
+
+const Montgomery_context& Rsa_cipher::mont_() const
+{
+    if (!m_mont)
+        throw std::logic_error("RSA key is not set.");
+    return *m_mont;
+}
+
+// c^d mod N from one exponentiation per prime, with exponents and moduli
+// of a fraction of the size, recombined with Garner's formula: starting from
+// m = c^d mod q, each further prime r with coefficient t adds
+// (product of the preceding primes) * (t * (c^d mod r - m) mod r).
+BigInt Rsa_cipher::decrypt_number_(const BigInt& c) const
+{
+    if (m_crt.empty())
+        throw std::logic_error("RSA key is not set.");
+
+    BigInt m = m_crt[0].mont.pow(c, m_crt[0].exponent);
+    for (size_t i = 1; i < m_crt.size(); i++) {
+        const Crt_factor_& factor = m_crt[i];
+        const BigInt& r = factor.mont.modulus();
+
+        BigInt difference = factor.mont.pow(c, factor.exponent) - m % r;
+        if (difference < 0)
+            difference += r;
+        // multiplying by a value in Montgomery form leaves an ordinary residue
+        BigInt h = factor.mont.mul(difference, factor.coefficient_mont);
+        m += factor.product * h;
+    }
+    return m;
+}
+
+// The largest number of bytes that always gives a number below N.
+size_t Rsa_cipher::block_size_() const
+{
+    size_t size = (mont_().modulus().bit_length() - 1) / 8;
+    if (size == 0)
+        throw std::logic_error("RSA modulus is too small for blocks.");
+    return size;
+}
+
+// Splits the length prefix and the bytes into blocks and encrypts each. The
+// last block is padded with zeros.
+std::vector<BigInt> Rsa_cipher::encrypt_blocks_(const std::string& bytes) const
+{
+    size_t block_size = block_size_();
+    std::string framed;
+    append_number_bytes(
+            BigInt((long long) bytes.size()), BLOCK_LENGTH_PREFIX, framed);
+    framed += bytes;
+    framed.append((block_size - framed.size() % block_size) % block_size, '\0');
+
+    std::vector<BigInt> blocks;
+    for (size_t i = 0; i < framed.size(); i += block_size) {
+        BigInt m = bytes_to_number(framed.data() + i, block_size);
+        blocks.push_back(mont_().pow(m, m_key.e));
+    }
+    return blocks;
+}
+
+std::string Rsa_cipher::decrypt_blocks_(const std::vector<BigInt>& blocks) const
+{
+    size_t block_size = block_size_();
+    std::string framed;
+    for (const BigInt& c : blocks) {
+        BigInt m = decrypt_number_(c);
+        if (m.bit_length() > 8 * block_size)
+            throw std::invalid_argument("Ciphertext block is out of range.");
+        append_number_bytes(m, block_size, framed);
+    }
+
+    if (framed.size() < BLOCK_LENGTH_PREFIX)
+        throw std::invalid_argument("Ciphertext is too short.");
+    BigInt length = bytes_to_number(framed.data(), BLOCK_LENGTH_PREFIX);
+    if (length > (long long) (framed.size() - BLOCK_LENGTH_PREFIX))
+        throw std::invalid_argument("Ciphertext length prefix is too large.");
+    return framed.substr(BLOCK_LENGTH_PREFIX, length.to_long_long());
 }
 
 }  // namespace petliukh::cryptography
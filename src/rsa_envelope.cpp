@@ -0,0 +1,259 @@
+#include "rsa_envelope.hpp"
+
+#include <memory>
+#include <stdexcept>
+#include <openssl/core_names.h>
+#include <openssl/evp.h>
+#include <openssl/param_build.h>
+#include <openssl/rand.h>
+#include <openssl/rsa.h>
+
+namespace petliukh::cryptography {
+
+static const char ENVELOPE_MAGIC[] = "RSAE";
+static const size_t ENVELOPE_MAGIC_SIZE = 4;
+static const unsigned char ENVELOPE_VERSION = 1;
+static const unsigned char CIPHER_AES_256_GCM = 1;
+static const size_t SESSION_KEY_SIZE = 32;
+static const size_t IV_SIZE = 12;
+static const size_t TAG_SIZE = 16;
+// magic, version, cipher id, key length, iv length and tag length
+static const size_t HEADER_SIZE = ENVELOPE_MAGIC_SIZE + 1 + 1 + 4 + 1 + 1;
+// OAEP with SHA-256 takes two digests and two bytes of every RSA block
+static const size_t OAEP_OVERHEAD = 2 * 32 + 2;
+
+using Cipher_context
+        = std::unique_ptr<EVP_CIPHER_CTX, decltype(&EVP_CIPHER_CTX_free)>;
+using Pkey = std::unique_ptr<EVP_PKEY, decltype(&EVP_PKEY_free)>;
+using Pkey_context
+        = std::unique_ptr<EVP_PKEY_CTX, decltype(&EVP_PKEY_CTX_free)>;
+using Bignum = std::unique_ptr<BIGNUM, decltype(&BN_free)>;
+using Param_builder
+        = std::unique_ptr<OSSL_PARAM_BLD, decltype(&OSSL_PARAM_BLD_free)>;
+using Params = std::unique_ptr<OSSL_PARAM, decltype(&OSSL_PARAM_free)>;
+
+static Cipher_context make_cipher_context()
+{
+    Cipher_context context(EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_free);
+    if (!context)
+        throw std::runtime_error("Could not allocate a cipher context.");
+    return context;
+}
+
+static void check(int openssl_result)
+{
+    if (openssl_result != 1)
+        throw std::runtime_error("OpenSSL cipher operation failed.");
+}
+
+static const unsigned char* bytes(const std::string& str, size_t offset = 0)
+{
+    return reinterpret_cast<const unsigned char*>(str.data() + offset);
+}
+
+static unsigned char* bytes(std::string& str, size_t offset = 0)
+{
+    return reinterpret_cast<unsigned char*>(&str[offset]);
+}
+
+static Bignum to_bignum(const BigInt& num)
+{
+    // big-endian bytes of the magnitude
+    std::string digits;
+    for (size_t i = (num.bit_length() + 7) / 8; i-- > 0;)
+        digits += static_cast<char>(num.limb(i / 8) >> (8 * (i % 8)));
+
+    Bignum result(BN_bin2bn(bytes(digits), digits.size(), nullptr), BN_free);
+    if (!result)
+        throw std::runtime_error("Could not allocate a big number.");
+    return result;
+}
+
+// An OpenSSL key with N and e, and d as well for decryption. The factors are
+// left out, as OpenSSL limits how many a key may have and a single
+// exponentiation per key transport does not need the CRT.
+static Pkey make_rsa_key(const Rsa_cipher& rsa, bool with_private)
+{
+    Rsa_cipher::Key key = rsa.get_key();
+    if (key.N == 0)
+        throw std::logic_error("RSA key is not set.");
+
+    Param_builder builder(OSSL_PARAM_BLD_new(), OSSL_PARAM_BLD_free);
+    if (!builder)
+        throw std::runtime_error("Could not allocate a parameter builder.");
+    Bignum n = to_bignum(key.N), e = to_bignum(key.e);
+    Bignum d = with_private ? to_bignum(key.d) : Bignum(nullptr, BN_free);
+    check(OSSL_PARAM_BLD_push_BN(builder.get(), OSSL_PKEY_PARAM_RSA_N, n.get()));
+    check(OSSL_PARAM_BLD_push_BN(builder.get(), OSSL_PKEY_PARAM_RSA_E, e.get()));
+    if (d) {
+        check(OSSL_PARAM_BLD_push_BN(
+                builder.get(), OSSL_PKEY_PARAM_RSA_D, d.get()));
+    }
+    Params params(OSSL_PARAM_BLD_to_param(builder.get()), OSSL_PARAM_free);
+    if (!params)
+        throw std::runtime_error("Could not build the RSA key parameters.");
+
+    Pkey_context context(
+            EVP_PKEY_CTX_new_from_name(nullptr, "RSA", nullptr),
+            EVP_PKEY_CTX_free);
+    if (!context)
+        throw std::runtime_error("Could not allocate a key context.");
+    EVP_PKEY* pkey = nullptr;
+    check(EVP_PKEY_fromdata_init(context.get()));
+    check(EVP_PKEY_fromdata(context.get(), &pkey,
+                            with_private ? EVP_PKEY_KEYPAIR : EVP_PKEY_PUBLIC_KEY,
+                            params.get()));
+    return Pkey(pkey, EVP_PKEY_free);
+}
+
+static Pkey_context make_oaep_context(EVP_PKEY* pkey, bool encrypt)
+{
+    Pkey_context context(
+            EVP_PKEY_CTX_new_from_pkey(nullptr, pkey, nullptr),
+            EVP_PKEY_CTX_free);
+    if (!context)
+        throw std::runtime_error("Could not allocate a key context.");
+    check(encrypt ? EVP_PKEY_encrypt_init(context.get())
+                  : EVP_PKEY_decrypt_init(context.get()));
+    check(EVP_PKEY_CTX_set_rsa_padding(context.get(), RSA_PKCS1_OAEP_PADDING));
+    check(EVP_PKEY_CTX_set_rsa_oaep_md(context.get(), EVP_sha256()));
+    check(EVP_PKEY_CTX_set_rsa_mgf1_md(context.get(), EVP_sha256()));
+    return context;
+}
+
+std::string rsa_oaep_encrypt(const Rsa_cipher& rsa, const std::string& message)
+{
+    Pkey pkey = make_rsa_key(rsa, false);
+    size_t size = EVP_PKEY_get_size(pkey.get());
+    if (size < message.size() + OAEP_OVERHEAD)
+        throw std::invalid_argument("RSA key is too short for OAEP.");
+
+    Pkey_context context = make_oaep_context(pkey.get(), true);
+    std::string ciphertext(size, '\0');
+    check(EVP_PKEY_encrypt(context.get(), bytes(ciphertext), &size,
+                           bytes(message), message.size()));
+    ciphertext.resize(size);
+    return ciphertext;
+}
+
+std::string rsa_oaep_decrypt(
+        const Rsa_cipher& rsa, const std::string& ciphertext)
+{
+    Pkey pkey = make_rsa_key(rsa, true);
+    size_t size = EVP_PKEY_get_size(pkey.get());
+    if (ciphertext.size() != size)
+        throw std::invalid_argument("OAEP ciphertext has a wrong size.");
+
+    Pkey_context context = make_oaep_context(pkey.get(), false);
+    std::string message(size, '\0');
+    if (EVP_PKEY_decrypt(context.get(), bytes(message), &size,
+                         bytes(ciphertext), ciphertext.size())
+        != 1)
+        throw std::invalid_argument("OAEP decryption failed.");
+    message.resize(size);
+    return message;
+}
+
+std::string rsa_envelope_seal(
+        const Rsa_cipher& rsa, const std::string& payload)
+{
+    std::string session_key(SESSION_KEY_SIZE, '\0');
+    std::string iv(IV_SIZE, '\0');
+    check(RAND_bytes(bytes(session_key), SESSION_KEY_SIZE));
+    check(RAND_bytes(bytes(iv), IV_SIZE));
+    std::string encrypted_key = rsa_oaep_encrypt(rsa, session_key);
+
+    std::string envelope(ENVELOPE_MAGIC, ENVELOPE_MAGIC_SIZE);
+    envelope += static_cast<char>(ENVELOPE_VERSION);
+    envelope += static_cast<char>(CIPHER_AES_256_GCM);
+    for (int shift = 24; shift >= 0; shift -= 8)
+        envelope += static_cast<char>(encrypted_key.size() >> shift);
+    envelope += static_cast<char>(IV_SIZE);
+    envelope += static_cast<char>(TAG_SIZE);
+    envelope += encrypted_key;
+    envelope += iv;
+
+    Cipher_context context = make_cipher_context();
+    check(EVP_EncryptInit_ex(context.get(), EVP_aes_256_gcm(), nullptr,
+                             nullptr, nullptr));
+    check(EVP_CIPHER_CTX_ctrl(
+            context.get(), EVP_CTRL_GCM_SET_IVLEN, IV_SIZE, nullptr));
+    check(EVP_EncryptInit_ex(
+            context.get(), nullptr, nullptr, bytes(session_key), bytes(iv)));
+
+    // everything before the ciphertext is authenticated as well
+    int length = 0;
+    check(EVP_EncryptUpdate(
+            context.get(), nullptr, &length, bytes(envelope), envelope.size()));
+
+    size_t offset = envelope.size();
+    envelope.resize(offset + payload.size() + TAG_SIZE);
+    if (!payload.empty()) {
+        check(EVP_EncryptUpdate(context.get(), bytes(envelope, offset), &length,
+                                bytes(payload), payload.size()));
+        offset += length;
+    }
+    check(EVP_EncryptFinal_ex(context.get(), bytes(envelope, offset), &length));
+    offset += length;
+    check(EVP_CIPHER_CTX_ctrl(context.get(), EVP_CTRL_GCM_GET_TAG, TAG_SIZE,
+                              bytes(envelope, offset)));
+    envelope.resize(offset + TAG_SIZE);
+    return envelope;
+}
+
+std::string rsa_envelope_open(
+        const Rsa_cipher& rsa, const std::string& envelope)
+{
+    if (envelope.size() < HEADER_SIZE
+        || envelope.compare(0, ENVELOPE_MAGIC_SIZE, ENVELOPE_MAGIC) != 0)
+        throw std::invalid_argument("Not an RSA envelope.");
+
+    const unsigned char* header = bytes(envelope, ENVELOPE_MAGIC_SIZE);
+    if (header[0] != ENVELOPE_VERSION || header[1] != CIPHER_AES_256_GCM)
+        throw std::invalid_argument("Unsupported envelope version or cipher.");
+
+    size_t key_size = 0;
+    for (int i = 2; i < 6; i++)
+        key_size = key_size << 8 | header[i];
+    size_t iv_size = header[6], tag_size = header[7];
+    if (iv_size == 0 || tag_size < 12 || tag_size > TAG_SIZE
+        || envelope.size() - HEADER_SIZE < key_size + iv_size + tag_size)
+        throw std::invalid_argument("Envelope is truncated.");
+
+    std::string session_key
+            = rsa_oaep_decrypt(rsa, envelope.substr(HEADER_SIZE, key_size));
+    if (session_key.size() != SESSION_KEY_SIZE)
+        throw std::invalid_argument("Envelope session key has a wrong size.");
+
+    size_t iv_offset = HEADER_SIZE + key_size;
+    size_t payload_offset = iv_offset + iv_size;
+    size_t payload_size = envelope.size() - payload_offset - tag_size;
+    std::string tag = envelope.substr(payload_offset + payload_size);
+
+    Cipher_context context = make_cipher_context();
+    check(EVP_DecryptInit_ex(context.get(), EVP_aes_256_gcm(), nullptr,
+                             nullptr, nullptr));
+    check(EVP_CIPHER_CTX_ctrl(
+            context.get(), EVP_CTRL_GCM_SET_IVLEN, iv_size, nullptr));
+    check(EVP_DecryptInit_ex(context.get(), nullptr, nullptr,
+                             bytes(session_key), bytes(envelope, iv_offset)));
+
+    int length = 0;
+    check(EVP_DecryptUpdate(context.get(), nullptr, &length, bytes(envelope),
+                            payload_offset));
+
+    std::string payload(payload_size, '\0');
+    if (payload_size != 0) {
+        check(EVP_DecryptUpdate(context.get(), bytes(payload), &length,
+                                bytes(envelope, payload_offset), payload_size));
+    }
+    check(EVP_CIPHER_CTX_ctrl(
+            context.get(), EVP_CTRL_GCM_SET_TAG, tag_size, bytes(tag)));
+
+    unsigned char final_block[16];
+    if (EVP_DecryptFinal_ex(context.get(), final_block, &length) != 1)
+        throw std::invalid_argument("Envelope authentication failed.");
+    return payload;
+}
+
+}  // namespace petliukh::cryptography
@@ -0,0 +1,164 @@
+#include "BigInt.hpp"
+
+#include <climits>
+#include <type_traits>
+#include <gtest/gtest.h>
+
+TEST(bigint, converts_to_and_from_string)
+{
+    std::string digits = "-123456789012345678901234567890123456789012345678901";
+    EXPECT_EQ(BigInt(digits).to_string(), digits);
+    EXPECT_EQ(BigInt("0000000000000000000000000000042").to_string(), "42");
+    EXPECT_EQ(BigInt("-0").to_string(), "0");
+    EXPECT_EQ(BigInt(LLONG_MIN).to_long_long(), LLONG_MIN);
+    EXPECT_THROW(BigInt("12a3"), std::invalid_argument);
+    EXPECT_THROW(BigInt("9223372036854775808").to_long_long(), std::out_of_range);
+}
+
+TEST(bigint, adds_and_subtracts_across_limbs)
+{
+    BigInt limb_max("18446744073709551615");  // 2^64 - 1
+    EXPECT_EQ(limb_max + 1, BigInt("18446744073709551616"));
+    EXPECT_EQ(BigInt("18446744073709551616") - 1, limb_max);
+    EXPECT_EQ(BigInt(5) - BigInt("340282366920938463463374607431768211456"),
+              BigInt("-340282366920938463463374607431768211451"));
+    EXPECT_EQ(BigInt(-7) + BigInt(7), 0);
+
+    // crossing the two-limb inline storage in both directions
+    BigInt inline_max = pow(BigInt(2), 128) - 1;
+    BigInt spilled = inline_max + 1;
+    EXPECT_EQ(spilled.to_string(), "340282366920938463463374607431768211456");
+    EXPECT_EQ(spilled - 1, inline_max);
+    EXPECT_EQ(inline_max * inline_max / inline_max, inline_max);
+}
+
+TEST(bigint, multiplies_and_divides_large_numbers)
+{
+    // (10^300 + 7)^2 exercises the Karatsuba path
+    BigInt num = big_pow10(300) + 7;
+    BigInt square = num * num;
+    EXPECT_EQ(square, big_pow10(600) + big_pow10(300) * 14 + 49);
+    EXPECT_EQ(square / num, num);
+    EXPECT_EQ(square % num, 0);
+    EXPECT_EQ((square + 5) % num, 5);
+    EXPECT_EQ(BigInt(-17) / 5, -3);
+    EXPECT_EQ(BigInt(-17) % 5, -2);
+    EXPECT_THROW(num / 0, std::logic_error);
+}
+
+TEST(bigint, divmod_returns_quotient_and_remainder)
+{
+    BigInt dividend = pow(BigInt(2), 200) + 12345;
+    BigInt divisor = pow(BigInt(2), 127) - 1;
+    auto [quotient, remainder] = divmod(dividend, divisor);
+    EXPECT_EQ(quotient, dividend / divisor);
+    EXPECT_EQ(remainder, dividend % divisor);
+    EXPECT_EQ(quotient * divisor + remainder, dividend);
+
+    std::tie(quotient, remainder) = divmod(BigInt(-17), BigInt(5));
+    EXPECT_EQ(quotient, -3);
+    EXPECT_EQ(remainder, -2);
+}
+
+TEST(bigint, moves_and_updates_in_place)
+{
+    static_assert(std::is_nothrow_move_constructible_v<BigInt>);
+    static_assert(std::is_nothrow_move_assignable_v<BigInt>);
+
+    BigInt big = big_pow10(100) + 1;
+    BigInt moved = std::move(big);
+    EXPECT_EQ(moved, big_pow10(100) + 1);
+
+    BigInt num = moved;
+    num += num;
+    EXPECT_EQ(num, moved * 2);
+    num -= moved * 3;
+    EXPECT_EQ(num, -moved);
+    num *= num;
+    EXPECT_EQ(num, moved * moved);
+    num %= moved - 1;
+    EXPECT_EQ(num, 1);
+    num -= num;
+    EXPECT_EQ(num, 0);
+}
+
+TEST(bigint, multiplies_in_every_tier)
+{
+    // (2^n - 1)^2 = 2^2n - 2^(n + 1) + 1, for operands of 100 limbs
+    // (Karatsuba), 600 limbs (Toom-3) and 17000 limbs (NTT)
+    for (int limbs : { 100, 600, 17000 }) {
+        int bits = 64 * limbs;
+        BigInt num = pow(BigInt(2), bits) - 1;
+        EXPECT_EQ(num * num, pow(BigInt(2), 2 * bits) - pow(BigInt(2), bits + 1) + 1);
+        EXPECT_EQ(num * (num + 2), pow(BigInt(2), 2 * bits) - 1);
+    }
+}
+
+TEST(bigint, shifts_and_combines_bits)
+{
+    BigInt num("340282366920938463463374607431768211457");  // 2^128 + 1
+
+    EXPECT_EQ(num.bit_length(), 129);
+    EXPECT_EQ(num.popcount(), 2);
+    EXPECT_TRUE(num.test_bit(128));
+    EXPECT_FALSE(num.test_bit(64));
+    EXPECT_EQ(BigInt(1) << 128, num - 1);
+    EXPECT_EQ(num >> 128, 1);
+    EXPECT_EQ((num << 70) >> 70, num);
+
+    // negative numbers shift and combine as two's complement
+    EXPECT_EQ(BigInt(-5) >> 1, -3);
+    EXPECT_EQ(-num >> 200, -1);
+    EXPECT_TRUE(BigInt(-2).test_bit(1000));
+    EXPECT_EQ(BigInt(-1) & num, num);
+    EXPECT_EQ(-num & num, 1);
+    EXPECT_EQ(BigInt(12) | 3, 15);
+    EXPECT_EQ(BigInt(-12) | 3, -9);
+    EXPECT_EQ(num ^ num, 0);
+    EXPECT_EQ(num ^ -1, -num - 1);
+}
+
+TEST(bigint, converts_long_numbers_and_parses_in_place)
+{
+    // long enough to be split at powers of ten and to divide by reciprocals
+    for (int digits : { 5000, 60000 }) {
+        std::string text = "9" + std::string(digits - 2, '0') + "7";
+        BigInt num(text);
+        EXPECT_EQ(num, pow(BigInt(10), digits - 1) * 9 + 7);
+        EXPECT_EQ(num.to_string(), text);
+        EXPECT_EQ((-num).to_string(), "-" + text);
+    }
+
+    std::string text = "12 -340282366920938463463374607431768211456x";
+    const char* end = text.data() + text.size();
+    BigInt num;
+    std::from_chars_result result = from_chars(text.data(), end, num);
+    EXPECT_EQ(result.ec, std::errc());
+    EXPECT_EQ(num, 12);
+    result = from_chars(result.ptr + 1, end, num);
+    EXPECT_EQ(num, -(BigInt(1) << 128));
+    EXPECT_EQ(*result.ptr, 'x');
+    result = from_chars(result.ptr, end, num);
+    EXPECT_EQ(result.ec, std::errc::invalid_argument);
+}
+
+TEST(bigint, takes_integer_square_roots)
+{
+    EXPECT_EQ(isqrt(0), 0);
+    EXPECT_EQ(isqrt(1), 1);
+    EXPECT_EQ(isqrt(48), 6);
+    EXPECT_EQ(isqrt(49), 7);
+    EXPECT_EQ(sqrt(BigInt(63)), 7);
+
+    // around perfect squares, natively and across several Newton levels
+    for (int bits : { 40, 64, 127, 200, 1000, 5000 }) {
+        BigInt root = (BigInt(1) << bits) - 12345;
+        BigInt square = root * root;
+        EXPECT_EQ(isqrt(square), root);
+        EXPECT_EQ(isqrt(square - 1), root - 1);
+        EXPECT_EQ(isqrt(square + root * 2), root);
+        EXPECT_EQ(isqrt(square + root * 2 + 1), root + 1);
+    }
+
+    EXPECT_THROW(isqrt(-4), std::invalid_argument);
+}
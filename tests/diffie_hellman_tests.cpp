@@ -1,4 +1,5 @@
 #include "diffie_hellman.hpp"
+#include "numeric_utils.hpp"
 #include <gtest/gtest.h>
 
 namespace cr = petliukh::cryptography;
@@ -17,3 +18,37 @@ TEST(diffie_hellman, test_key_exchange)
 
     EXPECT_EQ(K1, K2);
 }
+
+TEST(diffie_hellman, generates_safe_prime_groups)
+{
+    cr::Diffie_hellman_public_pair dh_pair
+            = cr::diffie_hellman_generate_public_pair(40);
+
+    EXPECT_EQ(dh_pair.p, dh_pair.q * 2 + 1);
+    EXPECT_TRUE(cr::is_prime(dh_pair.p));
+    EXPECT_TRUE(cr::is_prime(dh_pair.q));
+    EXPECT_GE(dh_pair.p.to_string().size(), 39u);
+    EXPECT_EQ(cr::mod_exp(dh_pair.g, dh_pair.q, dh_pair.p), 1);
+    EXPECT_NE(dh_pair.g, 1);
+}
+
+TEST(diffie_hellman, shares_through_generator_table)
+{
+    cr::Diffie_hellman_public_pair dh_pair
+            = cr::diffie_hellman_generate_public_pair(60);
+    cr::Fixed_base_exp generator = cr::diffie_hellman_generator_table(dh_pair);
+
+    for (int i = 0; i < 5; i++) {
+        BigInt secret = big_random(50) % dh_pair.q;
+        EXPECT_EQ(cr::diffie_hellman_share(generator, secret),
+                  cr::diffie_hellman_share(dh_pair, secret));
+    }
+
+    // a pair given as g and p only, as the app builds it
+    cr::Diffie_hellman_public_pair without_q{ dh_pair.g, dh_pair.p };
+    EXPECT_EQ(without_q.q, 0);
+    cr::Fixed_base_exp fallback = cr::diffie_hellman_generator_table(without_q);
+    BigInt secret = big_random(50) % dh_pair.q;
+    EXPECT_EQ(cr::diffie_hellman_share(fallback, secret),
+              cr::diffie_hellman_share(dh_pair, secret));
+}
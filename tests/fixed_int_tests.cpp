@@ -0,0 +1,46 @@
+#include "fixed_int.hpp"
+#include "numeric_utils.hpp"
+
+#include <gtest/gtest.h>
+
+namespace cr = petliukh::cryptography;
+
+using Int128 = cr::Fixed_int<128>;
+using Int256 = cr::Fixed_int<256>;
+
+static_assert(Int128(6) * Int128(7) == 42);
+static_assert(Int128(-7) / 2 == -3 && Int128(-7) % 2 == -1);
+static_assert(cr::mod_exp(Int128(3), Int128(200), Int128(1000003)) == 333986);
+
+TEST(fixed_int, matches_bigint_arithmetic)
+{
+    for (int i = 0; i < 100; i++) {
+        BigInt a = big_random(35), b = big_random(20) + 1;
+        if (i % 2)
+            a = -a;
+        if (i % 3 == 0)
+            b = -b;
+        Int256 fa(a), fb(b);
+
+        EXPECT_EQ((fa + fb).to_big_int(), a + b);
+        EXPECT_EQ((fa - fb).to_big_int(), a - b);
+        EXPECT_EQ((fa * fb).to_big_int(), a * b);
+        EXPECT_EQ((fa / fb).to_big_int(), a / b);
+        EXPECT_EQ((fa % fb).to_big_int(), a % b);
+        EXPECT_EQ(fa < fb, a < b);
+    }
+    EXPECT_THROW(Int128(pow(BigInt(2), 127)), std::out_of_range);
+    EXPECT_THROW(Int128(1) / 0, std::logic_error);
+}
+
+TEST(fixed_int, plugs_into_numeric_utils)
+{
+    BigInt p = pow(BigInt(2), 127) - 1;
+    BigInt a = big_random(30), e = big_random(40);
+    Int256 fp(p), fa(a), fe(e);
+
+    EXPECT_EQ(cr::mod_exp(fa, fe, fp).to_big_int(), cr::mod_exp(a, e, p));
+    EXPECT_EQ(cr::mod_exp(fa, fe, fp + 1).to_big_int(), cr::mod_exp(a, e, p + 1));
+    EXPECT_EQ(cr::mod_inverse(fa, fp).to_big_int(), cr::mod_inverse(a, p));
+    EXPECT_EQ(cr::mod_inverse(Int128(17), Int128(3120)), 2753);
+}
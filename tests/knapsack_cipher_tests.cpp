@@ -93,3 +93,19 @@ TEST(knapsack_sequence, encrypts_decrypts_correctly_bytes)
 
     ASSERT_EQ(bytes, decrypted);
 }
+
+TEST(knapsack_sequence, caches_codebook_tokens)
+{
+    cr::Knapsack_cipher ks;
+    ks.generate_rand_key(20);
+    std::u16string message = u"mississippi, міссісіпі";
+    std::u16string expected = ks.encrypt(message);
+
+    ks.set_codebook_capacity(3);
+    EXPECT_EQ(ks.encrypt(message), expected);
+    EXPECT_EQ(ks.encrypt(message), expected);
+    EXPECT_EQ(ks.decrypt(expected), message);
+
+    ks.generate_rand_key(20);
+    EXPECT_EQ(ks.decrypt(ks.encrypt(message)), message);
+}
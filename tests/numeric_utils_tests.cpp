@@ -0,0 +1,177 @@
+#include "numeric_utils.hpp"
+
+#include <gtest/gtest.h>
+
+namespace cr = petliukh::cryptography;
+
+TEST(numeric_utils, montgomery_context_matches_mod_exp)
+{
+    // 2^127 - 1 is prime, so Fermat's little theorem gives a^(p - 1) = 1
+    BigInt p = pow(BigInt(2), 127) - 1;
+    cr::Montgomery_context mont(p);
+
+    EXPECT_EQ(mont.pow(3, p - 1), 1);
+    EXPECT_EQ(mont.pow(12345, 0), 1);
+    EXPECT_EQ(mont.pow(-2, 3), p - 8);
+    EXPECT_EQ(mont.from_mont(mont.to_mont(987654321)), 987654321);
+
+    BigInt a = mont.to_mont(big_random(30)), b = mont.to_mont(big_random(30));
+    EXPECT_EQ(mont.from_mont(mont.mul(a, b)),
+              (mont.from_mont(a) * mont.from_mont(b)) % p);
+    EXPECT_EQ(mont.sqr(a), mont.mul(a, a));
+}
+
+TEST(numeric_utils, montgomery_context_rejects_even_modulus)
+{
+    EXPECT_THROW(cr::Montgomery_context(BigInt(50)), std::invalid_argument);
+    EXPECT_EQ(cr::mod_exp(3, 200, 50), 1);
+}
+
+TEST(numeric_utils, barrett_reducer_matches_modulo)
+{
+    BigInt m = big_random(40);
+    cr::Barrett_reducer reducer(m);
+
+    for (int i = 0; i < 50; i++) {
+        BigInt a = big_random(40) % m, b = big_random(40) % m;
+        EXPECT_EQ(reducer.mul(a, b), (a * b) % m);
+    }
+    EXPECT_EQ(reducer.reduce(m * m - 1), m - 1);
+    EXPECT_EQ(reducer.reduce(-1), m - 1);
+    EXPECT_EQ(reducer.reduce(m * m * m + 5), 5);
+    EXPECT_THROW(cr::Barrett_reducer(BigInt(0)), std::invalid_argument);
+}
+
+TEST(numeric_utils, mod_exp_splits_long_exponents)
+{
+    // a^(e1 + e2) = a^e1 * a^e2, with exponents long enough for the
+    // widest windows, for both an odd and an even modulus
+    BigInt e1 = big_random(400), e2 = big_random(400);
+    for (BigInt m : { pow(BigInt(2), 127) - 1, pow(BigInt(2), 130) + 6 }) {
+        BigInt a = big_random(50);
+        EXPECT_EQ(cr::mod_exp(a, e1 + e2, m),
+                  (cr::mod_exp(a, e1, m) * cr::mod_exp(a, e2, m)) % m);
+    }
+    EXPECT_EQ(cr::mod_exp(7, 0, 1), 0);
+    EXPECT_THROW(cr::mod_exp(7, -1, 10), std::invalid_argument);
+}
+
+TEST(numeric_utils, word_sized_operands_take_native_paths)
+{
+    // moduli on both sides of the 64- and 128-bit dispatch boundaries
+    for (int bits : { 20, 62, 63, 64, 126, 127, 128, 200 }) {
+        BigInt m = pow(BigInt(2), bits) - 1;
+        BigInt a = big_random(50) % m, e = big_random(40);
+
+        // every odd number is invertible modulo a power of two
+        BigInt inv = cr::mod_inverse(a * 2 + 1, m + 1);
+        EXPECT_EQ(((a * 2 + 1) * inv) % (m + 1), 1);
+        EXPECT_EQ(cr::mod_inverse(-(a * 2 + 1), m + 1), m + 1 - inv);
+        EXPECT_EQ(cr::mod_exp(a, e, m), cr::Montgomery_context(m).pow(a, e));
+        EXPECT_EQ(cr::mod_exp(a, e + 1, m + 1),
+                  (cr::mod_exp(a, e, m + 1) * a) % (m + 1));
+        EXPECT_EQ(gcd(m * 6, m * 4), m * 2);
+    }
+}
+
+TEST(numeric_utils, gcd_extended_returns_bezout_coefficients)
+{
+    BigInt g = big_random(30);
+    BigInt a = g * big_random(200), b = g * big_random(180);
+    BigInt x, y;
+    BigInt d = cr::gcd_extended(a, b, &x, &y);
+
+    EXPECT_EQ(d, gcd(a, b));
+    EXPECT_EQ(d % g, 0);
+    EXPECT_EQ(a * x + b * y, d);
+
+    long long lx, ly;
+    EXPECT_EQ(cr::gcd_extended(240LL, 46LL, &lx, &ly), 2);
+    EXPECT_EQ(240 * lx + 46 * ly, 2);
+    EXPECT_EQ(gcd(a, a + g), g);
+}
+
+TEST(numeric_utils, is_prime_rejects_pseudoprimes)
+{
+    for (int n : { 2, 3, 5, 47, 2203, 65537 })
+        EXPECT_TRUE(cr::is_prime(n));
+    for (int n : { -7, 0, 1, 4, 561, 2047, 2209 })
+        EXPECT_FALSE(cr::is_prime(n));
+
+    // strong pseudoprimes to all prime bases up to 23 and 41
+    EXPECT_FALSE(cr::is_prime(BigInt("3825123056546413051")));
+    BigInt psp("3317044064679887385961981");
+    EXPECT_FALSE(cr::is_prime(psp));
+    EXPECT_FALSE(cr::is_prime(psp, 0, cr::Primality_test::bpsw));
+
+    BigInt m127 = (BigInt(1) << 127) - 1, m521 = (BigInt(1) << 521) - 1;
+    for (auto test : { cr::Primality_test::miller_rabin,
+                       cr::Primality_test::bpsw }) {
+        EXPECT_TRUE(cr::is_prime(m127, 10, test));
+        EXPECT_TRUE(cr::is_prime(m521, 10, test));
+        EXPECT_FALSE(cr::is_prime(m127 * m127, 10, test));
+        EXPECT_FALSE(cr::is_prime(m127 * m521, 10, test));
+    }
+
+    EXPECT_EQ(cr::nearest_prime(100), 97);
+    EXPECT_EQ(cr::nearest_prime(3), 2);
+}
+
+TEST(numeric_utils, jacobi_symbol_follows_reciprocity)
+{
+    EXPECT_EQ(cr::jacobi(2, 7), 1);
+    EXPECT_EQ(cr::jacobi(3, 7), -1);
+    EXPECT_EQ(cr::jacobi(-1, 7), -1);
+    EXPECT_EQ(cr::jacobi(1001, 9907), -1);
+    EXPECT_EQ(cr::jacobi(21, 15), 0);
+    EXPECT_THROW(cr::jacobi(3, 8), std::invalid_argument);
+}
+
+TEST(numeric_utils, sieve_scans_for_primes_both_ways)
+{
+    EXPECT_EQ(cr::next_prime(0), 2);
+    EXPECT_EQ(cr::next_prime(13), 17);
+    EXPECT_EQ(cr::prev_prime(13), 11);
+    EXPECT_EQ(cr::prev_prime(3), 2);
+    EXPECT_THROW(cr::prev_prime(2), std::invalid_argument);
+
+    // 2^64 - 59 and 2^64 + 13 are the primes on either side of 2^64
+    BigInt two_64 = BigInt(1) << 64;
+    EXPECT_EQ(cr::prev_prime(two_64), two_64 - 59);
+    EXPECT_EQ(cr::next_prime(two_64), two_64 + 13);
+    EXPECT_EQ(cr::next_prime(two_64 - 59), two_64 + 13);
+
+    // survivors have no factor below 2^15 and are never skipped primes
+    BigInt start = (BigInt(1) << 200) + 1;
+    cr::Prime_sieve sieve(start);
+    BigInt expected = start;
+    for (int i = 0; i < 200; i++) {
+        BigInt candidate = sieve.next();
+        for (; expected < candidate; expected += 2)
+            EXPECT_FALSE(cr::is_prime(expected));
+        EXPECT_EQ(gcd(candidate, 3 * 5 * 7 * 32749), 1);
+        expected = candidate + 2;
+    }
+}
+
+TEST(numeric_utils, fixed_base_exp_matches_mod_exp)
+{
+    for (int bits : { 40, 100, 300, 1000 }) {
+        BigInt m = (BigInt(1) << bits) - 9 * 2 - 1;
+        BigInt g = big_random(bits / 3 + 5);
+        cr::Fixed_base_exp fixed(g, m);
+
+        EXPECT_EQ(fixed.pow(0), 1);
+        EXPECT_EQ(fixed.pow(1), g % m);
+        for (int i = 0; i < 5; i++) {
+            BigInt e = big_random(bits * 3 / 10 + 1);
+            EXPECT_EQ(fixed.pow(e), cr::mod_exp(g, e, m));
+        }
+        // longer than the table, so through mod_exp
+        BigInt e = big_random(bits / 2 + 20);
+        EXPECT_EQ(fixed.pow(e), cr::mod_exp(g, e, m));
+    }
+
+    EXPECT_EQ(cr::Fixed_base_exp(-3, 101, 10).pow(5), cr::mod_exp(-3, 5, 101));
+    EXPECT_THROW(cr::Fixed_base_exp(3, 100), std::invalid_argument);
+}
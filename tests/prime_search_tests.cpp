@@ -0,0 +1,57 @@
+#include "prime_search.hpp"
+
+#include <gtest/gtest.h>
+
+namespace cr = petliukh::cryptography;
+
+TEST(prime_search, finds_the_next_prime_after_each_seeded_start)
+{
+    cr::Prime_search_options options;
+    options.digits = 40;
+    options.count = 3;
+    options.threads = 4;
+    options.seed = 12345;
+    cr::Prime_search_result result = cr::find_primes(options);
+
+    EXPECT_EQ(result.seed, 12345u);
+    ASSERT_EQ(result.primes.size(), 3u);
+
+    std::mt19937_64 generator(12345);
+    for (const BigInt& prime : result.primes) {
+        BigInt start = big_random(40, generator);
+        EXPECT_EQ(prime, cr::next_prime(start - 1));
+    }
+}
+
+TEST(prime_search, repeats_a_search_from_its_seed)
+{
+    cr::Prime_search_options options;
+    options.digits = 60;
+    options.count = 2;
+    cr::Prime_search_result first = cr::find_primes(options);
+
+    options.seed = first.seed;
+    options.threads = 1;
+    EXPECT_EQ(cr::find_primes(options).primes, first.primes);
+}
+
+TEST(prime_search, finds_safe_primes)
+{
+    cr::Prime_search_options options;
+    options.digits = 30;
+    options.count = 2;
+    options.safe = true;
+    options.seed = 7;
+
+    std::mt19937_64 generator(7);
+    for (const BigInt& prime : cr::find_primes(options).primes) {
+        BigInt q = prime >> 1;
+        EXPECT_TRUE(cr::is_prime(q));
+        EXPECT_TRUE(cr::is_prime(prime));
+
+        // no safe prime is skipped between the start and the result
+        BigInt start = big_random(30, generator) >> 1;
+        for (BigInt c = start | 1; c < q; c += 2)
+            EXPECT_FALSE(cr::is_prime(c) && cr::is_prime(c * 2 + 1));
+    }
+}
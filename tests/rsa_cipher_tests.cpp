@@ -40,3 +40,121 @@ TEST(rsa_cipher, ecnrypts_correctl)
 
     ASSERT_EQ(plaintext, decrypted);
 }
+
+TEST(rsa_cipher, decrypts_with_crt_key)
+{
+    cr::Rsa_cipher rsa;
+    rsa.set_key(u"1000000007 998244353");
+
+    cr::Rsa_cipher::Key key = rsa.get_key();
+    EXPECT_EQ(key.d_p, key.d % (key.p - 1));
+    EXPECT_EQ(key.d_q, key.d % (key.q - 1));
+    EXPECT_EQ(key.q * key.q_inv % key.p, 1);
+
+    rsa.generate_rand_key(40);
+    std::u16string plaintext = u"Привіт, CRT!";
+    EXPECT_EQ(rsa.decrypt(rsa.encrypt(plaintext)), plaintext);
+
+    EXPECT_THROW(rsa.set_key(u"101 101"), std::invalid_argument);
+    EXPECT_THROW(rsa.set_key(u"2 1000003"), std::invalid_argument);
+}
+
+TEST(rsa_cipher, generates_and_decrypts_multi_prime_keys)
+{
+    cr::Rsa_cipher rsa;
+    std::u16string plaintext = u"Multi-prime RSA";
+
+    for (size_t num_primes : { 3, 4 }) {
+        rsa.generate_rand_key(40, num_primes);
+        cr::Rsa_cipher::Key key = rsa.get_key();
+        ASSERT_EQ(key.other_primes.size(), num_primes - 2);
+
+        BigInt product = key.p * key.q;
+        for (const auto& info : key.other_primes) {
+            EXPECT_EQ(info.d, key.d % (info.r - 1));
+            EXPECT_EQ(product * info.t % info.r, 1);
+            product *= info.r;
+        }
+        EXPECT_EQ(product, key.N);
+        EXPECT_EQ(rsa.decrypt(rsa.encrypt(plaintext)), plaintext);
+
+        cr::Rsa_cipher copy;
+        copy.set_key(cr::utf8_to_utf16(key.to_string()));
+        EXPECT_EQ(copy.decrypt(rsa.encrypt(plaintext)), plaintext);
+    }
+
+    // the shortest primes allowed, and combinations that cannot be met
+    for (int i = 0; i < 5; i++) {
+        rsa.generate_rand_key(4, 4);
+        EXPECT_TRUE(rsa.get_key().N % 2 != 0);
+    }
+    EXPECT_THROW(rsa.generate_rand_key(1, 3), std::invalid_argument);
+    EXPECT_THROW(rsa.generate_rand_key(2, 5), std::invalid_argument);
+    EXPECT_THROW(rsa.generate_rand_key(30, 30), std::invalid_argument);
+}
+
+TEST(rsa_cipher, packs_messages_into_blocks)
+{
+    cr::Rsa_cipher rsa;
+    rsa.generate_rand_key(40);
+    rsa.set_mode(cr::Rsa_cipher::Mode::block);
+
+    std::u16string plaintext = u"Block mode packs many characters: �耀";
+    std::u16string ciphertext = rsa.encrypt(plaintext);
+    EXPECT_EQ(rsa.decrypt(ciphertext), plaintext);
+    EXPECT_EQ(rsa.decrypt(rsa.encrypt(u"")), u"");
+
+    // two bytes per character and an 8-byte prefix, in blocks below N
+    size_t n_bits = rsa.get_key().N.bit_length();
+    size_t block_size = (n_bits - 1) / 8;
+    size_t numbers = std::count(ciphertext.begin(), ciphertext.end(), u' ') + 1;
+    EXPECT_EQ(numbers, (8 + 2 * plaintext.size() + block_size - 1) / block_size);
+
+    std::string bytes("\0raw\xff bytes\0", 12);
+    std::string encrypted = rsa.encrypt_raw_bytes(bytes);
+    EXPECT_EQ(encrypted.size(), (n_bits + 7) / 8);
+    EXPECT_EQ(rsa.decrypt_raw_bytes(encrypted), bytes);
+    EXPECT_THROW(rsa.decrypt_raw_bytes(encrypted.substr(1)),
+                 std::invalid_argument);
+}
+
+TEST(rsa_cipher, caches_codebook_tokens)
+{
+    cr::Rsa_cipher rsa;
+    rsa.generate_rand_key(20);
+    std::u16string plaintext = u"abracadabra, абракадабра";
+    std::u16string expected = rsa.encrypt(plaintext);
+
+    rsa.set_codebook_capacity(4);
+    EXPECT_EQ(rsa.encrypt(plaintext), expected);
+    EXPECT_EQ(rsa.encrypt(plaintext), expected);
+    EXPECT_EQ(rsa.decrypt(expected), plaintext);
+    EXPECT_THROW(rsa.decrypt(u"x3"), std::invalid_argument);
+
+    rsa.generate_rand_key(20);
+    EXPECT_EQ(rsa.decrypt(rsa.encrypt(plaintext)), plaintext);
+    rsa.set_codebook_capacity(0);
+    EXPECT_EQ(rsa.decrypt(rsa.encrypt(plaintext)), plaintext);
+}
+
+TEST(rsa_cipher, encrypts_code_units_above_0x8000)
+{
+    cr::Rsa_cipher rsa;
+    std::u16string plaintext = u"Aé耀￿中";
+
+    for (int i = 0; i < 5; i++) {
+        rsa.generate_rand_key(10);
+        EXPECT_EQ(rsa.decrypt(rsa.encrypt(plaintext)), plaintext);
+    }
+
+    // code units u from 0x8000 used to be encrypted as the int16_t
+    // u - 0x10000, giving -((0x10000 - u)^e mod N) for the odd e
+    rsa.set_key(u"1000000007 998244353");
+    for (char16_t chr : { u'\x8000', u'\x9000', u'\xFFFF' }) {
+        BigInt legacy = BigInt(0)
+                        - cr::mod_exp(0x10000 - (long long) chr,
+                                      rsa.get_key().e, rsa.get_key().N);
+        EXPECT_EQ(rsa.decrypt(cr::utf8_to_utf16(legacy.to_string())),
+                  std::u16string(1, chr));
+    }
+}
@@ -0,0 +1,72 @@
+#include "rsa_cipher.hpp"
+#include "rsa_envelope.hpp"
+
+#include <gtest/gtest.h>
+
+namespace cr = petliukh::cryptography;
+
+TEST(rsa_envelope, seals_and_opens_payloads)
+{
+    cr::Rsa_cipher rsa;
+    rsa.generate_rand_key(150);
+
+    std::string payload(100000, '\0');
+    for (size_t i = 0; i < payload.size(); i++)
+        payload[i] = static_cast<char>(i * 131 + 7);
+
+    std::string envelope = cr::rsa_envelope_seal(rsa, payload);
+    EXPECT_EQ(envelope.substr(0, 4), "RSAE");
+    EXPECT_EQ(cr::rsa_envelope_open(rsa, envelope), payload);
+    EXPECT_EQ(cr::rsa_envelope_open(rsa, cr::rsa_envelope_seal(rsa, "")), "");
+
+    // fresh session keys, so the same payload seals differently
+    EXPECT_NE(cr::rsa_envelope_seal(rsa, payload), envelope);
+
+    const cr::Rsa_cipher& const_rsa = rsa;
+    EXPECT_EQ(cr::rsa_envelope_open(
+                      const_rsa, cr::rsa_envelope_seal(const_rsa, payload)),
+              payload);
+}
+
+TEST(rsa_envelope, rejects_tampered_envelopes)
+{
+    cr::Rsa_cipher rsa;
+    rsa.generate_rand_key(150);
+    std::string envelope = cr::rsa_envelope_seal(rsa, "attack at dawn");
+
+    std::string tampered = envelope;
+    tampered[tampered.size() - 20] ^= 1;
+    EXPECT_THROW(cr::rsa_envelope_open(rsa, tampered), std::invalid_argument);
+
+    tampered = envelope;
+    tampered.back() ^= 1;
+    EXPECT_THROW(cr::rsa_envelope_open(rsa, tampered), std::invalid_argument);
+
+    EXPECT_THROW(cr::rsa_envelope_open(rsa, envelope.substr(0, 20)),
+                 std::invalid_argument);
+    EXPECT_THROW(cr::rsa_envelope_open(rsa, "not an envelope"),
+                 std::invalid_argument);
+}
+
+TEST(rsa_envelope, wraps_keys_with_random_padding)
+{
+    cr::Rsa_cipher rsa;
+    rsa.generate_rand_key(150);
+    std::string key(32, '\x5a');
+
+    std::string first = cr::rsa_oaep_encrypt(rsa, key);
+    std::string second = cr::rsa_oaep_encrypt(rsa, key);
+    EXPECT_NE(first, second);
+    EXPECT_EQ(first.size(), (rsa.get_key().N.bit_length() + 7) / 8);
+    EXPECT_EQ(cr::rsa_oaep_decrypt(rsa, first), key);
+    EXPECT_EQ(cr::rsa_oaep_decrypt(rsa, second), key);
+
+    first[first.size() / 2] ^= 1;
+    EXPECT_THROW(cr::rsa_oaep_decrypt(rsa, first), std::invalid_argument);
+
+    // too short to fit the padding around a session key
+    cr::Rsa_cipher short_rsa;
+    short_rsa.generate_rand_key(40);
+    EXPECT_THROW(cr::rsa_envelope_seal(short_rsa, "payload"),
+                 std::invalid_argument);
+}